@@ -0,0 +1,1476 @@
+// ELEC2645 Unit 2 Project - Engineering Calculator
+// Benchmark harness (make bench): times the library kernels against the
+// original implementations, and the application paths built on them.
+//
+// The application code is compiled in from funcs.c, so the benchmarks can
+// reach its static helpers (generators, plot renderer, pipeline, server,
+// result cache); the library itself comes from libelec.a.
+
+#include "funcs.c"
+#ifdef __linux__
+#include <spawn.h>
+#include <sys/wait.h>
+#endif
+
+// CONSTANTS
+
+#define BENCH_RUNS 5               // timed runs per kernel and size in bench sweep
+#define BENCH_MIN_SAMPLES (1 << 20) // samples processed per timed run, at least
+
+// BENCHMARKS
+
+// Send stdout to /dev/null while a benchmark prints. Returns the saved
+// descriptor for unmute_stdout, -1 if stdout could not be redirected.
+static int mute_stdout(void) {
+    fflush(stdout);
+    int saved = -1;
+    int null_fd = open("/dev/null", O_WRONLY);
+    if (null_fd >= 0) {
+        saved = dup(STDOUT_FILENO);
+        dup2(null_fd, STDOUT_FILENO);
+        close(null_fd);
+    }
+    return saved;
+}
+
+static void unmute_stdout(int saved) {
+    fflush(stdout);
+    if (saved >= 0) {
+        dup2(saved, STDOUT_FILENO);
+        close(saved);
+    }
+}
+
+// The original save_result: open, append one line, close
+static void save_result_unbuffered(const char *path, const char *text) {
+    FILE *f = fopen(path, "a");
+    if (f != NULL) {
+        fprintf(f, "%s\n", text);
+        fclose(f);
+    }
+}
+
+// bench results [records] : records/sec of per-record open/append/close
+// against the buffered sink, in every sink format
+static int bench_results(int records) {
+    static const char *names[] = { "text", "csv", "bin" };
+    const char *path = "bench_results.tmp";
+    Waveform wave = { .count = 100, .amplitude = 15.0f, .frequency = 200.0f };
+    strcpy(wave.waveform_type, "Sine");
+    
+    remove(path);
+    double start = now_seconds();
+    for (int i = 0; i < records; i++) {
+        char buf[RESULT_RECORD_MAX];
+        snprintf(buf, sizeof(buf), "Waveform Generated: %s, Freq=%.2f Hz, Amp=%.2f, Samples=%d",
+            wave.waveform_type, wave.frequency, wave.amplitude, wave.count);
+        save_result_unbuffered(path, buf);
+    }
+    double elapsed = now_seconds() - start;
+    printf("open/append/close  %12.0f records/sec\n", records / elapsed);
+    
+    for (int f = RESULT_FORMAT_TEXT; f <= RESULT_FORMAT_BINARY; f++) {
+        remove(path);
+        configure_results(path, (ResultFormat)f, RESULT_FLUSH_INTERVAL);
+        start = now_seconds();
+        for (int i = 0; i < records; i++) {
+            save_waveform_result(&wave);
+        }
+        close_results();
+        elapsed = now_seconds() - start;
+        printf("buffered sink %-4s %12.0f records/sec\n", names[f], records / elapsed);
+    }
+    
+    remove(path);
+    return 0;
+}
+
+// The original generators: time from a float sample index, sinf/fmodf per sample
+static void legacy_generate(Waveform *wave, int type) {
+    for (int i = 0; i < wave->count; i++) {
+        float t = (float)i / wave->sample_rate;
+        float phase = fmodf(wave->frequency * t, 1.0f);
+        if (type == 1) {
+            wave->samples[i] = wave->amplitude * sinf(2.0f * PI * wave->frequency * t);
+        } else if (type == 2) {
+            wave->samples[i] = (phase < 0.5f) ? wave->amplitude : -wave->amplitude;
+        } else {
+            wave->samples[i] = wave->amplitude * (4.0f * fabsf(phase - 0.5f) - 1.0f);
+        }
+    }
+}
+
+// Largest deviation from a double precision evaluation at the exact phase
+static double waveform_max_error(const Waveform *wave, int type) {
+    double increment = (double)wave->frequency / wave->sample_rate;
+    double worst = 0.0;
+    for (int i = 0; i < wave->count; i++) {
+        double phase = fmod((double)i * increment, 1.0);
+        double exact;
+        if (type == 1) {
+            exact = wave->amplitude * sin(2.0 * PI * phase);
+        } else if (type == 2) {
+            exact = (phase < 0.5) ? wave->amplitude : -wave->amplitude;
+        } else {
+            exact = wave->amplitude * (4.0 * fabs(phase - 0.5) - 1.0);
+        }
+        if (type == 2 && (fabs(phase - 0.5) < 1e-9 || phase < 1e-9 || phase > 1.0 - 1e-9)) {
+            continue;   // on an edge either level is correct
+        }
+        double err = fabs(wave->samples[i] - exact);
+        if (err > worst) worst = err;
+    }
+    return worst;
+}
+
+// bench waveform [samples] : throughput and accuracy of the oscillators
+// against the original per-sample sinf/fmodf generators
+static int bench_waveform(int samples) {
+    static const char *names[] = { "", "sine", "square", "triangle" };
+    Waveform wave = { .count = samples, .amplitude = 1.0f, .frequency = 997.0f, .sample_rate = 48000.0f };
+    if (!alloc_waveform(&wave)) return batch_error("bench", "out of memory");
+    
+    printf("%-9s %-10s %14s %12s\n", "waveform", "generator", "samples/sec", "max error");
+    for (int type = 1; type <= 3; type++) {
+        double start = now_seconds();
+        legacy_generate(&wave, type);
+        double elapsed = now_seconds() - start;
+        printf("%-9s %-10s %14.0f %12.3g\n", names[type], "legacy",
+               samples / elapsed, waveform_max_error(&wave, type));
+        
+        start = now_seconds();
+        generate_waveform(&wave, type);
+        elapsed = now_seconds() - start;
+        printf("%-9s %-10s %14.0f %12.3g\n", names[type], "oscillator",
+               samples / elapsed, waveform_max_error(&wave, type));
+    }
+    
+    free_waveform(&wave);
+    return 0;
+}
+
+// bench noise [samples] : rand() against the counter-based generator, and a
+// check that the threaded fill matches the single-threaded one bit for bit
+static int bench_noise(int samples) {
+    float *a = malloc((size_t)samples * sizeof(float));
+    float *b = malloc((size_t)samples * sizeof(float));
+    if (a == NULL || b == NULL) {
+        free(a);
+        free(b);
+        return batch_error("bench", "out of memory");
+    }
+    int threads = elec_get_worker_threads();
+    
+    double start = now_seconds();
+    for (int i = 0; i < samples; i++) {
+        a[i] = 2.0f * ((float)rand() / RAND_MAX) - 1.0f;
+    }
+    double elapsed = now_seconds() - start;
+    printf("%-22s %14.0f samples/sec\n", "rand()", samples / elapsed);
+    
+    static const struct { const char *name; NoiseFill fill; } kinds[] = {
+        { "uniform", elec_noise_uniform },
+        { "gaussian", elec_noise_gaussian },
+    };
+    for (int k = 0; k < 2; k++) {
+        elec_set_worker_threads(1);
+        start = now_seconds();
+        elec_fill_noise(kinds[k].fill, 12345, 1.0f, a, samples);
+        elapsed = now_seconds() - start;
+        printf("%-9s 1 thread     %14.0f samples/sec\n", kinds[k].name, samples / elapsed);
+        
+        int counts[] = { threads, 7 };
+        for (int c = 0; c < 2; c++) {
+            elec_set_worker_threads(counts[c]);
+            start = now_seconds();
+            elec_fill_noise(kinds[k].fill, 12345, 1.0f, b, samples);
+            elapsed = now_seconds() - start;
+            printf("%-9s %-2d threads   %14.0f samples/sec  (%s)\n", kinds[k].name, counts[c],
+                   samples / elapsed, memcmp(a, b, (size_t)samples * sizeof(float)) == 0 ? "identical" : "MISMATCH");
+        }
+    }
+    elec_set_worker_threads(threads);
+    
+    free(a);
+    free(b);
+    return 0;
+}
+
+// bench threads [samples] : scaling of the parallel analysis from one
+// thread up to the configured count, checking every result is identical
+static int bench_threads(int samples) {
+    Waveform wave = { .count = samples, .amplitude = 1.0f, .seed = 1, .has_seed = 1 };
+    if (!alloc_waveform(&wave)) return batch_error("bench", "out of memory");
+    generate_gaussian(&wave);
+    
+    int max_threads = elec_get_worker_threads();
+    SignalStats first;
+    double base = 0.0;
+    
+    printf("%7s %14s %8s  %s\n", "threads", "samples/sec", "speedup", "rms / peak-to-peak / average");
+    for (int threads = 1; ; ) {
+        elec_set_worker_threads(threads);
+        SignalStats st;
+        elec_compute_stats_parallel(wave.samples, samples, &st);   // warm up the pool
+        
+        double start = now_seconds();
+        elec_compute_stats_parallel(wave.samples, samples, &st);
+        double elapsed = now_seconds() - start;
+        if (threads == 1) {
+            first = st;
+            base = elapsed;
+        }
+        
+        int same = st.sum == first.sum && st.sum_squares == first.sum_squares &&
+                   st.min == first.min && st.max == first.max;
+        printf("%7d %14.0f %7.2fx  %.9g / %.9g / %.9g (%s)\n", threads, samples / elapsed, base / elapsed,
+               elec_calculate_rms(&st), elec_calculate_peak_to_peak(&st), elec_calculate_average(&st),
+               same ? "identical" : "MISMATCH");
+        
+        if (threads == max_threads) break;
+        threads = (threads * 2 < max_threads) ? threads * 2 : max_threads;
+    }
+    
+    elec_set_worker_threads(max_threads);
+    free_waveform(&wave);
+    return 0;
+}
+
+// bench eseries [targets] : standard part selection for log-spaced cutoffs
+// from 1 Hz to 1 MHz
+static int bench_eseries(int targets) {
+    float *cutoffs = malloc((size_t)targets * sizeof(float));
+    ComponentMatch *matches = malloc((size_t)targets * sizeof(ComponentMatch));
+    if (cutoffs == NULL || matches == NULL) {
+        free(cutoffs);
+        free(matches);
+        return batch_error("bench", "out of memory");
+    }
+    for (int i = 0; i < targets; i++) {
+        cutoffs[i] = (float)pow(10.0, 6.0 * i / targets);
+    }
+    
+    static const char *names[] = { "E12", "E24", "E96" };
+    for (int k = 0; k < 3; k++) {
+        const ESeries *series = find_e_series(names[k]);
+        double start = now_seconds();
+        match_components_batch(series, cutoffs, targets, matches);
+        double elapsed = now_seconds() - start;
+        
+        double worst = 0.0;
+        for (int i = 0; i < targets; i++) {
+            if (fabs(matches[i].error) > worst) worst = fabs(matches[i].error);
+        }
+        printf("%s  %d targets in %.3f ms (%.0f targets/sec), worst error %.3f%%\n",
+               names[k], targets, elapsed * 1e3, targets / elapsed, worst * 100.0);
+    }
+    
+    free(cutoffs);
+    free(matches);
+    return 0;
+}
+
+// bench bode [points] : libm evaluation of the filter response against the
+// vectorized sweep, single and multi-threaded, with the largest deviation
+static int bench_bode(int points) {
+    float *buf = malloc((size_t)points * 6 * sizeof(float));
+    if (buf == NULL) return batch_error("bench", "out of memory");
+    float *ref_mag = buf, *ref_phase = buf + points;
+    float *frequency = buf + 2 * (size_t)points, *magnitude = buf + 3 * (size_t)points, *phase = buf + 4 * (size_t)points;
+    
+    static const char *names[] = { "high-pass", "low-pass" };
+    int threads = elec_get_worker_threads();
+    printf("%-9s %-12s %14s %12s %12s\n", "filter", "evaluation", "points/sec", "max dB err", "max deg err");
+    
+    for (int is_lowpass = 1; is_lowpass >= 0; is_lowpass--) {
+        FilterConfig filter;
+        elec_solve_filter(&filter, is_lowpass, 1000.0f, 1, 1000.0f);
+        FrequencySweep sweep;
+        elec_sweep_init(&sweep, &filter, 1.0, 1e6, points);
+        
+        double start = now_seconds();
+        for (int i = 0; i < points; i++) {
+            double x = sweep.start * pow(10.0, i * sweep.step) / sweep.cutoff_freq;
+            double gain = -10.0 * log10(1.0 + x * x) + (is_lowpass ? 0.0 : 20.0 * log10(x));
+            ref_mag[i] = (float)gain;
+            ref_phase[i] = (float)((is_lowpass ? 0.0 : 90.0) - atan(x) * 180.0 / PI);
+        }
+        double elapsed = now_seconds() - start;
+        printf("%-9s %-12s %14.0f\n", names[is_lowpass], "libm", points / elapsed);
+        
+        int counts[] = { 1, threads };
+        for (int c = 0; c < (threads > 1 ? 2 : 1); c++) {
+            elec_set_worker_threads(counts[c]);
+            elec_evaluate_response(&sweep, 0, points, frequency, magnitude, phase);   // warm up
+            start = now_seconds();
+            elec_evaluate_response(&sweep, 0, points, frequency, magnitude, phase);
+            elapsed = now_seconds() - start;
+            
+            double worst_mag = 0.0, worst_phase = 0.0;
+            for (int i = 0; i < points; i++) {
+                if (fabs(magnitude[i] - ref_mag[i]) > worst_mag) worst_mag = fabs(magnitude[i] - ref_mag[i]);
+                if (fabs(phase[i] - ref_phase[i]) > worst_phase) worst_phase = fabs(phase[i] - ref_phase[i]);
+            }
+            char label[32];
+            snprintf(label, sizeof(label), "sweep %d thr", counts[c]);
+            printf("%-9s %-12s %14.0f %12.3g %12.3g\n", names[is_lowpass], label, points / elapsed, worst_mag, worst_phase);
+        }
+    }
+    elec_set_worker_threads(threads);
+    
+    free(buf);
+    return 0;
+}
+
+// bench rcfilter [samples] : single-channel filtering speed and gain at the
+// cutoff, chunked against one-pass output, and a bank of channels filtered
+// together against one channel at a time
+static int bench_rcfilter(int samples) {
+    float *in = malloc((size_t)samples * sizeof(float));
+    float *a = malloc((size_t)samples * sizeof(float));
+    float *b = malloc((size_t)samples * sizeof(float));
+    if (in == NULL || a == NULL || b == NULL) {
+        free(in);
+        free(a);
+        free(b);
+        return batch_error("bench", "out of memory");
+    }
+    
+    // Sine at the cutoff: the output should be 3 dB down
+    Oscillator osc;
+    elec_osc_init(&osc, 1000.0, 48000.0);
+    elec_osc_sine(&osc, 1.0f, in, samples);
+    
+    static const char *names[] = { "high-pass", "low-pass" };
+    printf("%-9s %-12s %14s  %s\n", "filter", "channels", "samples/sec", "result");
+    for (int is_lowpass = 1; is_lowpass >= 0; is_lowpass--) {
+        FilterConfig filter;
+        elec_solve_filter(&filter, is_lowpass, 1000.0f, 1, 1000.0f);
+        FilterBank bank;
+        if (!elec_filter_bank_init(&bank, 1)) break;
+        elec_filter_bank_set(&bank, 0, &filter, 48000.0);
+        
+        double start = now_seconds();
+        elec_filter_bank_run(&bank, in, a, samples);
+        double elapsed = now_seconds() - start;
+        
+        SignalStats st_in, st_out;
+        elec_compute_stats(in, samples, &st_in);
+        elec_compute_stats(a, samples, &st_out);
+        printf("%-9s %-12s %14.0f  gain at fc %.3f dB\n", names[is_lowpass], "1", samples / elapsed,
+               20.0 * log10(elec_calculate_rms(&st_out) / elec_calculate_rms(&st_in)));
+        
+        // The same signal in uneven chunks
+        elec_filter_bank_set(&bank, 0, &filter, 48000.0);
+        for (long long i = 0; i < samples; i += 1000) {
+            long long n = (samples - i < 1000) ? samples - i : 1000;
+            elec_filter_bank_run(&bank, in + i, b + i, n);
+        }
+        printf("%-9s %-12s %14s  chunked output %s\n", names[is_lowpass], "1", "",
+               memcmp(a, b, (size_t)samples * sizeof(float)) == 0 ? "identical" : "MISMATCH");
+        elec_filter_bank_free(&bank);
+    }
+    
+    // Interleaved channels with different cutoffs
+    int counts[] = { 8, 64 };
+    for (int k = 0; k < 2; k++) {
+        int channels = counts[k];
+        long long frames = samples / channels;
+        FilterBank bank;
+        if (!elec_filter_bank_init(&bank, channels)) break;
+        for (int c = 0; c < channels; c++) {
+            FilterConfig filter;
+            elec_solve_filter(&filter, c % 2, 100.0f * (c + 1), 1, 1000.0f);
+            elec_filter_bank_set(&bank, c, &filter, 48000.0);
+        }
+        
+        double start = now_seconds();
+        elec_filter_bank_run(&bank, in, a, frames);
+        double elapsed = now_seconds() - start;
+        char label[32];
+        snprintf(label, sizeof(label), "%d together", channels);
+        printf("%-9s %-12s %14.0f\n", "mixed", label, frames * channels / elapsed);
+        
+        // One channel at a time over the strided frames
+        start = now_seconds();
+        for (int c = 0; c < channels; c++) {
+            double v = 0.0, previous = 0.0;
+            for (long long f = 0; f < frames; f++) {
+                double x = in[f * channels + c];
+                v = bank.decay[c] * v + bank.gain[c] * (x - previous);
+                previous = x;
+                b[f * channels + c] = (float)(x - v + bank.highpass[c] * (2.0 * v - x));
+            }
+        }
+        elapsed = now_seconds() - start;
+        snprintf(label, sizeof(label), "%d one by one", channels);
+        printf("%-9s %-12s %14.0f  %s\n", "mixed", label, frames * channels / elapsed,
+               memcmp(a, b, (size_t)(frames * channels) * sizeof(float)) == 0 ? "identical" : "MISMATCH");
+        elec_filter_bank_free(&bank);
+    }
+    
+    free(in);
+    free(a);
+    free(b);
+    return 0;
+}
+
+// bench fft [samples] : the real FFT from 1024 points up to the largest
+// power of 2 within samples, cache-blocked against stage-by-stage, its
+// largest deviation from a direct DFT, and Welch spectrum throughput
+static int bench_fft(int samples) {
+    int max_size = 1 << 10;
+    while (max_size < (1 << ELEC_FFT_MAX_LOG) && max_size * 2 <= samples) max_size *= 2;
+    
+    double *re = malloc((size_t)max_size * sizeof(double));
+    double *im = re == NULL ? NULL : re + max_size / 2;
+    double *power = malloc(((size_t)max_size / 2 + 1) * sizeof(double));
+    if (re == NULL || power == NULL) {
+        free(re);
+        free(power);
+        return batch_error("bench", "out of memory");
+    }
+    
+    // Accuracy against the direct DFT of a 1024-point pseudo-random signal
+    const FftPlan *plan = elec_get_fft_plan(1024);
+    double x[1024], worst = 0.0, top = 0.0;
+    for (int i = 0; i < 1024; i++) {
+        x[i] = sin(0.37 * i) + 0.25 * cos(1.91 * i * i / 1024.0);
+    }
+    for (int k = 0; k < 512; k++) {
+        re[k] = x[2 * k];
+        im[k] = x[2 * k + 1];
+    }
+    memset(power, 0, 513 * sizeof(double));
+    if (plan != NULL) {
+        elec_fft_complex(plan, re, im);
+        elec_fft_real_power(plan, re, im, power);
+    }
+    for (int k = 0; k <= 512; k++) {
+        double xr = 0.0, xi = 0.0;
+        for (int i = 0; i < 1024; i++) {
+            xr += x[i] * cos(-2.0 * PI * k * i / 1024.0);
+            xi += x[i] * sin(-2.0 * PI * k * i / 1024.0);
+        }
+        double direct = xr * xr + xi * xi;
+        if (direct > top) top = direct;
+        if (fabs(power[k] - direct) > worst) worst = fabs(power[k] - direct);
+    }
+    printf("1024-point power error relative to peak: %.3g\n\n", worst / top);
+    
+    printf("%-10s %14s %14s\n", "size", "blocked ns/pt", "plain ns/pt");
+    for (int size = 1 << 10; size <= max_size; size *= 2) {
+        plan = elec_get_fft_plan(size);
+        if (plan == NULL) break;
+        int m = size / 2;
+        int repeats = (1 << 23) / size + 1;
+        double per_point[2];
+        for (int pass = 0; pass < 2; pass++) {
+            int block = (pass == 0) ? ELEC_FFT_BLOCK : m;
+            double start = now_seconds();
+            for (int r = 0; r < repeats; r++) {
+                for (int k = 0; k < m; k++) {
+                    re[k] = (double)((k * 7919) % 1000) / 1000.0;
+                    im[k] = (double)((k * 104729) % 1000) / 1000.0;
+                }
+                elec_fft_complex_blocked(plan, re, im, block);
+                elec_fft_real_power(plan, re, im, power);
+            }
+            per_point[pass] = (now_seconds() - start) * 1e9 / ((double)repeats * size);
+        }
+        printf("%-10d %14.2f %14.2f\n", size, per_point[0], per_point[1]);
+    }
+    free(re);
+    free(power);
+    
+    // Welch spectrum of a test tone, 4096 points with Hann window
+    Waveform wave = { .count = samples, .amplitude = 1.0f, .frequency = 1003.7f, .sample_rate = 48000.0f };
+    Spectrum sp;
+    if (!alloc_waveform(&wave) || !elec_spectrum_init(&sp, 4096, WINDOW_HANN, wave.sample_rate)) {
+        free_waveform(&wave);
+        return batch_error("bench", "out of memory");
+    }
+    generate_waveform(&wave, 1);
+    
+    double start = now_seconds();
+    elec_spectrum_update(&sp, wave.samples, samples);
+    SpectralResult res;
+    int ok = elec_analyze_spectrum(&sp, &res);
+    double elapsed = now_seconds() - start;
+    if (ok) {
+        printf("\nWelch 4096 hann: %.0f samples/sec, %.4f Hz (tone %.4f Hz), SNR %.1f dB\n",
+               samples / elapsed, res.frequency, wave.frequency, res.snr_db);
+    }
+    elec_spectrum_free(&sp);
+    free_waveform(&wave);
+    return ok ? 0 : batch_error("bench", "too few samples for a spectrum");
+}
+
+// bench monitor [samples] : sliding-window updates per second against
+// recomputing the window, checked against it at intervals, and the whole
+// text path (parse, update, report every 1000 samples)
+static int bench_monitor(int samples) {
+    const int window = 4800;
+    if (samples < window) samples = window;
+    Waveform wave = { .count = samples, .amplitude = 0.1f, .seed = 1, .has_seed = 1 };
+    SlidingStats ss = { 0 };
+    if (!alloc_waveform(&wave) || !elec_sliding_init(&ss, window)) {
+        free_waveform(&wave);
+        return batch_error("bench", "out of memory");
+    }
+    generate_waveform(&wave, 5);
+    for (int i = 0; i < samples; i++) {
+        wave.samples[i] += 1.0f + sinf(i * 0.001f);
+    }
+    
+    // Incremental updates, compared with a full pass at ten points
+    double worst = 0.0, elapsed = 0.0;
+    for (int part = 1; part <= 10; part++) {
+        long long end = (long long)samples * part / 10;
+        double start = now_seconds();
+        elec_sliding_update(&ss, wave.samples + ss.count, end - ss.count);
+        elapsed += now_seconds() - start;
+        
+        SignalStats got, want;
+        elec_sliding_stats(&ss, &got);
+        long long from = (end > window) ? end - window : 0;
+        elec_compute_stats(wave.samples + from, end - from, &want);
+        double diffs[] = { elec_calculate_rms(&got) - elec_calculate_rms(&want),
+                           elec_calculate_average(&got) - elec_calculate_average(&want),
+                           elec_calculate_peak_to_peak(&got) - elec_calculate_peak_to_peak(&want) };
+        for (int k = 0; k < 3; k++) {
+            if (fabs(diffs[k]) > worst) worst = fabs(diffs[k]);
+        }
+    }
+    printf("%-22s %14s\n", "window 4800", "samples/sec");
+    printf("%-22s %14.0f  max deviation %.3g\n", "sliding", samples / elapsed, worst);
+    
+    // Recomputing the whole window per sample, over a short stretch
+    long long naive = samples / 1000 + 1;
+    double start = now_seconds();
+    volatile float sink = 0.0f;
+    for (long long i = 0; i < naive; i++) {
+        SignalStats st;
+        elec_compute_stats(wave.samples + i % (samples - window + 1), window, &st);
+        sink += elec_calculate_rms(&st);
+    }
+    printf("%-22s %14.0f\n", "recompute per sample", naive / (now_seconds() - start));
+    
+    // Text in, one report per 1000 samples out
+    char *text = malloc((size_t)samples * 16);
+    FILE *out = fopen("/dev/null", "w");
+    if (text != NULL && out != NULL) {
+        size_t len = 0;
+        for (int i = 0; i < samples; i++) {
+            len += (size_t)sprintf(text + len, "%.6f\n", wave.samples[i]);
+        }
+        FILE *in = fmemopen(text, len, "r");
+        TextReader reader;
+        if (in != NULL && text_reader_init(&reader, in)) {
+            elec_sliding_free(&ss);
+            elec_sliding_init(&ss, window);
+            start = now_seconds();
+            if (monitor_stream(&reader, &ss, 1000, out, 1)) {
+                printf("%-22s %14.0f  (%.0f MB/s)\n", "text monitor", samples / (now_seconds() - start),
+                       len / (now_seconds() - start) / 1e6);
+            }
+            text_reader_free(&reader);
+        }
+        if (in != NULL) fclose(in);
+    }
+    if (out != NULL) fclose(out);
+    free(text);
+    elec_sliding_free(&ss);
+    free_waveform(&wave);
+    return 0;
+}
+
+// The original plot: PLOT_HEIGHT passes over every PLOT_WIDTH-th sample,
+// one printf per character
+static void legacy_plot_values(const float *values, int count) {
+    float min_val = values[0];
+    float max_val = values[0];
+    for (int i = 1; i < count; i++) {
+        if (values[i] < min_val) min_val = values[i];
+        if (values[i] > max_val) max_val = values[i];
+    }
+    float margin = (max_val - min_val) * 0.1f;
+    min_val -= margin;
+    max_val += margin;
+    float range = max_val - min_val;
+    if (range < 1e-6f) range = 1.0f;
+    
+    int step = (count > PLOT_WIDTH) ? (count / PLOT_WIDTH) : 1;
+    int plot_samples = (count + step - 1) / step;
+    for (int row = 0; row < PLOT_HEIGHT; row++) {
+        float y_level = max_val - (row * range / (PLOT_HEIGHT - 1));
+        printf("|");
+        for (int col = 0; col < plot_samples && col * step < count; col++) {
+            float sample = values[col * step];
+            float tolerance = range / (PLOT_HEIGHT * 2);
+            if (fabsf(sample - y_level) < tolerance) {
+                printf("*");
+            } else if (row == PLOT_HEIGHT / 2) {
+                printf("-");
+            } else {
+                printf(" ");
+            }
+        }
+        printf("\n");
+    }
+    printf("+");
+    for (int i = 0; i < plot_samples; i++) printf("-");
+    printf("\n");
+}
+
+// bench plot [samples] : render time of a sine with single-sample spikes,
+// against the original plot, and how many spikes each one shows
+static int bench_plot(int samples) {
+    const int spikes = 8;
+    if (samples < PLOT_WIDTH * spikes) samples = PLOT_WIDTH * spikes;
+    Waveform wave = { .count = samples, .amplitude = 1.0f, .sample_rate = 48000.0f };
+    wave.frequency = wave.sample_rate * 3 / samples;
+    char *frame = malloc((PLOT_WIDTH + 2) * (PLOT_HEIGHT + 1));
+    if (!alloc_waveform(&wave) || frame == NULL) {
+        free_waveform(&wave);
+        free(frame);
+        return batch_error("bench", "out of memory");
+    }
+    generate_waveform(&wave, 1);
+    for (int k = 0; k < spikes; k++) {
+        wave.samples[(long long)samples * (2 * k + 1) / (2 * spikes) + 1] = 2.0f;
+    }
+    
+    // Both render into /dev/null through stdout
+    int saved = dup(STDOUT_FILENO);
+    int null_fd = open("/dev/null", O_WRONLY);
+    if (saved < 0 || null_fd < 0) {
+        free_waveform(&wave);
+        free(frame);
+        return batch_error("bench", "cannot open /dev/null");
+    }
+    fflush(stdout);
+    dup2(null_fd, STDOUT_FILENO);
+    double start = now_seconds();
+    plot_values(wave.samples, samples);
+    double renderer = now_seconds() - start;
+    start = now_seconds();
+    legacy_plot_values(wave.samples, samples);
+    fflush(stdout);
+    double legacy = now_seconds() - start;
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+    close(null_fd);
+    
+    // Spikes reach the top row of the min/max plot; the original shows one
+    // only if a spike falls on a sampled index
+    float lo[PLOT_WIDTH], hi[PLOT_WIDTH];
+    PlotJob job = { wave.samples, samples, PLOT_WIDTH, lo, hi };
+    elec_parallel_for(PLOT_WIDTH, plot_column, &job);
+    render_plot(frame, lo, hi, PLOT_WIDTH, PLOT_HEIGHT);
+    size_t stride = PLOT_WIDTH + 2;
+    int top = 0;
+    while (top < PLOT_HEIGHT && memchr(frame + top * stride, '*', stride) == NULL) top++;
+    int shown = 0, legacy_shown = 0, step = samples / PLOT_WIDTH;
+    for (int c = 0; c < PLOT_WIDTH; c++) {
+        if (frame[top * stride + 1 + c] == '*') shown++;
+        if (c * step < samples && wave.samples[c * step] == 2.0f) legacy_shown++;
+    }
+    
+    printf("%-10s %12s %14s\n", "plot", "ms", "spikes shown");
+    printf("%-10s %12.3f %11d/%d\n", "min/max", renderer * 1e3, shown, spikes);
+    printf("%-10s %12.3f %11d/%d\n", "original", legacy * 1e3, legacy_shown, spikes);
+    free_waveform(&wave);
+    free(frame);
+    return 0;
+}
+
+// bench export [samples] : generation plus conversion to each format in
+// memory, against writing the same export to a file through writev() and
+// through a mapping
+static int bench_export(int samples) {
+    Waveform wave = { .count = samples, .amplitude = 0.5f, .frequency = 997.0f, .sample_rate = 192000.0f };
+    unsigned char *out = malloc((size_t)samples * 4);
+    if (out == NULL) return batch_error("bench", "out of memory");
+    
+    printf("%-8s %14s %10s\n", "format", "samples/sec", "MB/s");
+    for (int format = EXPORT_PCM16; format <= EXPORT_RAW; format++) {
+        ExportJob job = { &wave, 1, (ExportFormat)format, 1.0f, 0, samples, out };
+        double start = now_seconds();
+        elec_parallel_for((samples + EXPORT_CHUNK - 1) / EXPORT_CHUNK, export_chunk, &job);
+        double elapsed = now_seconds() - start;
+        printf("%-8s %14.0f %10.1f\n", export_formats[format].name, samples / elapsed,
+               (double)samples * export_formats[format].bytes / elapsed / 1e6);
+    }
+    free(out);
+    
+    char path[] = "/tmp/export_bench_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) return batch_error("bench", "cannot create temporary file");
+    close(fd);
+    printf("\n%-8s %14s %10s\n", "pcm24", "samples/sec", "MB/s");
+    const char *modes[] = { "writev", "mmap" };
+    for (int m = 0; m < 2; m++) {
+        export_mmap_min = (m == 0) ? INT64_MAX : 0;
+        double start = now_seconds();
+        const char *error = export_waveform(&wave, 1, EXPORT_PCM24, 1.0f, path);
+        double elapsed = now_seconds() - start;
+        if (error != NULL) {
+            printf("%-8s %s\n", modes[m], error);
+        } else {
+            printf("%-8s %14.0f %10.1f\n", modes[m], samples / elapsed, samples * 3.0 / elapsed / 1e6);
+        }
+    }
+    export_mmap_min = EXPORT_MMAP_MIN;
+    unlink(path);
+    return 0;
+}
+
+// bench convert [values] : each unit conversion one value at a time against
+// the array version, and the error bound of the fast dBm paths
+static int bench_convert(int values) {
+    const int n = 16384;    // stays in cache, so this measures the arithmetic
+    float *in = malloc((size_t)n * 3 * sizeof(float));
+    if (in == NULL) return batch_error("bench", "out of memory");
+    float *a = in + n, *b = a + n;
+    long long repeats = values / n + 1;
+    
+    printf("%-12s %14s %14s %9s\n", "conversion", "scalar/sec", "array/sec", "speedup");
+    for (int c = 0; c < UNIT_CONVERSIONS; c++) {
+        for (int i = 0; i < n; i++) {
+            in[i] = (c == 1) ? 1e-3f + i * 0.37f : -60.0f + i * 0.01f;
+        }
+        double start = now_seconds();
+        for (long long r = 0; r < repeats; r++) {
+            for (int i = 0; i < n; i++) a[i] = unit_conversions[c].convert(in[i]);
+            __asm__ volatile("" : : "r"(a) : "memory");
+        }
+        double scalar = now_seconds() - start;
+        start = now_seconds();
+        for (long long r = 0; r < repeats; r++) {
+            unit_conversions[c].convert_array(in, b, n);
+            __asm__ volatile("" : : "r"(b) : "memory");
+        }
+        double array = now_seconds() - start;
+        printf("%-12s %14.0f %14.0f %8.1fx\n", unit_conversions[c].name, repeats * n / scalar,
+               repeats * n / array, scalar / array);
+    }
+    
+    // Largest errors in units of the last place of the float result, against
+    // double precision over the whole range, for the array and scalar versions
+    double worst[2][2] = { { 0.0, 0.0 }, { 0.0, 0.0 } };
+    for (int c = 0; c < 2; c++) {
+        for (int pass = 0; pass < 64; pass++) {
+            for (int i = 0; i < n; i++) {
+                double t = (double)(pass * n + i) / (64.0 * n);
+                in[i] = (c == 0) ? (float)(-379.0 + 758.0 * t) : (float)pow(2.0, -126.0 + 253.9 * t);
+            }
+            unit_conversions[c].convert_array(in, b, n);
+            for (int i = 0; i < n; i++) {
+                double exact = (c == 0) ? pow(10.0, in[i] / 10.0) : 10.0 * log10((double)in[i]);
+                double ulp = fabs(nextafterf((float)exact, INFINITY) - (float)exact);
+                float results[2] = { b[i], unit_conversions[c].convert(in[i]) };
+                for (int k = 0; k < 2; k++) {
+                    double err = fabs(results[k] - exact) / ulp;
+                    if (err > worst[c][k]) worst[c][k] = err;
+                }
+            }
+        }
+    }
+    printf("\nmax error: dbm2mw %.1f ulp (scalar %.1f), mw2dbm %.1f ulp (scalar %.1f)\n",
+           worst[0][0], worst[0][1], worst[1][0], worst[1][1]);
+    free(in);
+    return 0;
+}
+
+// bench arena [samples] : a stream of requests each generating and
+// analysing a waveform of about samples samples, with a buffer from malloc
+// and free per request against one from the session arena
+static int bench_arena(int samples) {
+    const int requests = 200;
+    Waveform wave = { .amplitude = 1.0f, .frequency = 997.0f, .sample_rate = 48000.0f };
+    double checksum[2] = { 0.0, 0.0 };
+    double elapsed[2];
+    SampleArena before = session_arena;
+    
+    for (int pass = 0; pass < 2; pass++) {
+        double start = now_seconds();
+        for (int r = 0; r < requests; r++) {
+            wave.count = samples - (r % 4) * (samples / 16);   // similar, not equal, sizes
+            if (wave.count < 1) wave.count = 1;
+            if (pass == 0) {
+                wave.samples = malloc((size_t)wave.count * sizeof(float));
+            } else {
+                alloc_waveform(&wave);
+            }
+            if (wave.samples == NULL) return batch_error("bench", "out of memory");
+            
+            generate_waveform(&wave, 1);
+            SignalStats st;
+            elec_compute_stats_parallel(wave.samples, wave.count, &st);
+            checksum[pass] += elec_calculate_rms(&st);
+            
+            if (pass == 0) {
+                free(wave.samples);
+                wave.samples = NULL;
+            } else {
+                free_waveform(&wave);
+            }
+        }
+        elapsed[pass] = now_seconds() - start;
+    }
+    
+    printf("%-14s %14s %14s\n", "buffers", "requests/sec", "samples/sec");
+    printf("%-14s %14.0f %14.0f\n", "malloc/free", requests / elapsed[0], (double)requests * samples / elapsed[0]);
+    printf("%-14s %14.0f %14.0f\n", "session arena", requests / elapsed[1], (double)requests * samples / elapsed[1]);
+    printf("\narena: %lld allocations, %lld reuses, peak %.1f MB held (limit %.0f MB)%s\n",
+           session_arena.allocations - before.allocations, session_arena.reuses - before.reuses,
+           session_arena.peak / 1048576.0, session_arena.limit / 1048576.0,
+           checksum[0] == checksum[1] ? "" : ", RESULTS DIFFER");
+    return 0;
+}
+
+// bench pipeline [samples] : generate, filter and analyse a signal stage by
+// stage through a whole buffer against the four-thread pipeline, with the
+// stalls of each ring (sleeps of its producer on a full ring / consumer on
+// an empty one) and a check that both give the same statistics
+static int bench_pipeline(int samples) {
+    static const int types[] = { 1, 5 };
+    Waveform wave = { .count = samples, .amplitude = 1.0f, .frequency = 997.0f, .sample_rate = 48000.0f,
+                      .seed = 12345, .has_seed = 1 };
+    FilterConfig filter;
+    elec_solve_filter(&filter, 1, 2000.0f, 1, 1000.0f);
+    
+    printf("%-9s %-9s %14s %8s  %s\n", "signal", "mode", "samples/sec", "speedup", "ring stalls (full/empty)");
+    for (int t = 0; t < 2; t++) {
+        SignalStats before[2], after[2];
+        double elapsed[2];
+        
+        double start = now_seconds();
+        if (!alloc_waveform(&wave)) return batch_error("bench", "out of memory");
+        generate_waveform(&wave, types[t]);
+        int ok = filter_waveform(&filter, &wave, &before[0], &after[0]);
+        free_waveform(&wave);
+        if (!ok) return batch_error("bench", "out of memory");
+        elapsed[0] = now_seconds() - start;
+        
+        Pipeline p = { .wave = &wave, .type = types[t], .out_fd = -1 };
+        start = now_seconds();
+        const char *error = run_pipeline(&p, &filter);
+        if (error != NULL) return batch_error("bench", error);
+        elapsed[1] = now_seconds() - start;
+        before[1] = p.before;
+        after[1] = p.after;
+        
+        // Block sizes differ, so the sums may be added in a different order
+        double diff = fabs(after[1].sum_squares - after[0].sum_squares) / after[0].sum_squares +
+                      fabs(before[1].sum_squares - before[0].sum_squares) / before[0].sum_squares;
+        int same = after[1].count == after[0].count && after[1].min == after[0].min &&
+                   after[1].max == after[0].max && before[1].min == before[0].min &&
+                   before[1].max == before[0].max && diff < 1e-9;
+        
+        printf("%-9s %-9s %14.0f %8s\n", wave.waveform_type, "staged", samples / elapsed[0], "1.00x");
+        printf("%-9s %-9s %14.0f %7.2fx  %lld/%lld %lld/%lld %lld/%lld%s\n", wave.waveform_type, "pipeline",
+               samples / elapsed[1], elapsed[0] / elapsed[1],
+               p.generated.producer_stalls, p.generated.consumer_stalls,
+               p.filtered.producer_stalls, p.filtered.consumer_stalls,
+               p.output.producer_stalls, p.output.consumer_stalls, same ? "" : "  RESULTS DIFFER");
+    }
+    return 0;
+}
+
+#ifdef __linux__
+
+#define BENCH_SERVE_CLIENTS 8
+#define BENCH_SERVE_SPAWNS 100    // process starts timed for comparison
+
+extern char **environ;
+
+// Ask a running server to stop (from any thread)
+static void server_stop(Server *srv) {
+    __atomic_store_n(&srv->stop, 1, __ATOMIC_RELEASE);
+    uint64_t one = 1;
+    if (write(srv->wake_fd, &one, sizeof(one)) < 0) {
+        // the counter is already non-zero, so the loop will wake anyway
+    }
+}
+
+// One client of bench serve: requests from the mix, one at a time
+typedef struct {
+    const char *path;
+    int requests;
+    int first;              // where in the mix it starts
+    double *latencies;      // seconds, one per request
+    int failed;
+} ServeClient;
+
+static void *bench_serve_client(void *arg) {
+    static const char *mix[] = {
+        "dbm2mw 10 20 30\n", "filter lp 1000 r 1000\n", "stats 1 2 3 4 5 6 7 8\n",
+        "generate sine 1 1000 48000 256\n", "c2f 25\n"
+    };
+    ServeClient *c = arg;
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    strcpy(addr.sun_path, c->path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        if (fd >= 0) close(fd);
+        c->failed = 1;
+        return NULL;
+    }
+    
+    char reply[8192];
+    for (int i = 0; i < c->requests && !c->failed; i++) {
+        const char *request = mix[(c->first + i) % 5];
+        double start = now_seconds();
+        if (!write_all(fd, request, strlen(request))) c->failed = 1;
+        size_t len = 0;
+        while (!c->failed && (len == 0 || reply[len - 1] != '\n')) {
+            ssize_t n = recv(fd, reply + len, sizeof(reply) - len, 0);
+            if (n <= 0 || (len += (size_t)n) == sizeof(reply)) c->failed = 1;
+        }
+        c->latencies[i] = now_seconds() - start;
+        if (strncmp(reply, "ok", 2) != 0) c->failed = 1;
+    }
+    close(fd);
+    return NULL;
+}
+
+static void *bench_serve_loop(void *arg) {
+    server_run(arg);
+    return NULL;
+}
+
+// bench serve [requests] : round trips of a mix of conversions, filter
+// designs, statistics and 256-sample waveforms from several clients at
+// once, with their latency percentiles, against starting a process per
+// conversion
+static int bench_serve(int requests) {
+    const char *path = "bench_serve.sock";
+    Server *srv = calloc(1, sizeof(Server));
+    double *latencies = malloc((size_t)requests * sizeof(double));
+    if (srv == NULL || latencies == NULL) {
+        free(srv);
+        free(latencies);
+        return batch_error("bench", "out of memory");
+    }
+    const char *error = server_open(srv, path, SERVER_WORKERS, 0);
+    pthread_t loop;
+    if (error == NULL && pthread_create(&loop, NULL, bench_serve_loop, srv) != 0) {
+        server_close(srv);
+        error = "cannot start the server thread";
+    }
+    if (error != NULL) {
+        free(srv);
+        free(latencies);
+        return batch_error("bench", error);
+    }
+    
+    ServeClient clients[BENCH_SERVE_CLIENTS];
+    pthread_t threads[BENCH_SERVE_CLIENTS];
+    int started = 0, done = 0, failed = 0;
+    double start = now_seconds();
+    for (int i = 0; i < BENCH_SERVE_CLIENTS; i++) {
+        int n = requests / BENCH_SERVE_CLIENTS + (i < requests % BENCH_SERVE_CLIENTS);
+        clients[i] = (ServeClient){ path, n, i, latencies + done, 0 };
+        done += n;
+        if (pthread_create(&threads[i], NULL, bench_serve_client, &clients[i]) != 0) break;
+        started++;
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+        failed |= clients[i].failed;
+    }
+    double elapsed = now_seconds() - start;
+    
+    server_stop(srv);
+    pthread_join(loop, NULL);
+    double server_p50, server_p99;
+    server_percentiles(srv, &server_p50, &server_p99);
+    server_close(srv);
+    free(srv);
+    if (failed || started < BENCH_SERVE_CLIENTS) {
+        free(latencies);
+        return batch_error("bench", "a client failed");
+    }
+    
+    qsort(latencies, (size_t)requests, sizeof(double), compare_doubles);
+    double p50 = latencies[(requests - 1) / 2], p99 = latencies[(requests - 1) * 99 / 100];
+    free(latencies);
+    
+    // The same work as one process per request, by the main.out next to
+    // this harness
+    char main_path[4096] = "main.out";
+    ssize_t len = readlink("/proc/self/exe", main_path, sizeof(main_path) - sizeof("main.out"));
+    if (len > 0) {
+        main_path[len] = '\0';
+        char *slash = strrchr(main_path, '/');
+        strcpy((slash != NULL) ? slash + 1 : main_path, "main.out");
+    }
+    char *args[] = { "main.out", "--results", "/dev/null", "dbm2mw", "10", NULL };
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    double spawn_start = now_seconds();
+    int spawns = 0;
+    for (; spawns < BENCH_SERVE_SPAWNS; spawns++) {
+        pid_t pid;
+        int status;
+        if (posix_spawn(&pid, main_path, &actions, NULL, args, environ) != 0) break;
+        waitpid(pid, &status, 0);
+    }
+    double spawn_time = (spawns > 0) ? (now_seconds() - spawn_start) / spawns : 0.0;
+    posix_spawn_file_actions_destroy(&actions);
+    
+    printf("%-22s %14s %10s %10s\n", "", "requests/sec", "p50 us", "p99 us");
+    printf("%-22s %14.0f %10.1f %10.1f\n", "server (client side)", requests / elapsed, p50 * 1e6, p99 * 1e6);
+    printf("%-22s %14s %10.1f %10.1f\n", "server (in server)", "", server_p50 * 1e6, server_p99 * 1e6);
+    if (spawns > 0) printf("%-22s %14.0f %10.1f\n", "process per request", 1.0 / spawn_time, spawn_time * 1e6);
+    printf("\n%d clients, %d workers\n", BENCH_SERVE_CLIENTS, SERVER_WORKERS);
+    return 0;
+}
+
+#endif /* __linux__ */
+
+// bench cache [samples] : the menu's waveform request (generate, then
+// plot) repeated over a few distinct requests of about samples samples,
+// with the result cache off and on
+static int bench_cache(int samples) {
+    const int requests = 200, distinct = 4;
+    ResultCache saved = result_cache;
+    double elapsed[2];
+    
+    for (int pass = 0; pass < 2; pass++) {
+        result_cache = (ResultCache){ .budget = pass ? CACHE_MEMORY_LIMIT : 0 };
+        int out = mute_stdout();
+        double start = now_seconds();
+        for (int r = 0; r < requests; r++) {
+            Waveform wave = { .count = samples, .amplitude = 15.0f, .frequency = 200.0f + 100.0f * (r % distinct),
+                              .sample_rate = 48000.0f };
+            if (!alloc_waveform(&wave)) {
+                unmute_stdout(out);
+                result_cache = saved;
+                return batch_error("bench", "out of memory");
+            }
+            generate_waveform_cached(&wave, 1);
+            plot_waveform(&wave, 1);
+            free_waveform(&wave);
+        }
+        elapsed[pass] = now_seconds() - start;
+        unmute_stdout(out);
+        
+        if (pass == 1) {
+            printf("%-8s %14s %8s\n", "cache", "requests/sec", "speedup");
+            printf("%-8s %14.0f %8s\n", "off", requests / elapsed[0], "1.00x");
+            printf("%-8s %14.0f %7.2fx\n", "on", requests / elapsed[1], elapsed[0] / elapsed[1]);
+            printf("\n%lld hits, %lld misses, %lld entries, %.1f MB held\n", result_cache.hits,
+                   result_cache.misses, result_cache.entries, result_cache.used / 1048576.0);
+        }
+        while (result_cache.oldest != NULL) {
+            cache_drop_oldest();
+        }
+        free(result_cache.spill);
+    }
+    result_cache = saved;
+    return 0;
+}
+
+// bench capture [samples] : statistics of raw int16 samples widened to float
+// (the way captures were analysed before) against the exact integer path,
+// on one thread, then the integer path on every thread count
+static int bench_capture(int samples) {
+    int16_t *raw = malloc((size_t)samples * (sizeof(int16_t) + sizeof(int32_t)));
+    if (raw == NULL) return batch_error("bench", "out of memory");
+    int32_t *raw32 = (int32_t *)(raw + samples + (samples & 1));
+    
+    // Gaussian ADC counts, clipped to the int16 range
+    float buf[STREAM_CHUNK_SAMPLES];
+    for (long long i = 0; i < samples; i += STREAM_CHUNK_SAMPLES) {
+        int n = (samples - i < STREAM_CHUNK_SAMPLES) ? (int)(samples - i) : STREAM_CHUNK_SAMPLES;
+        elec_noise_gaussian(1, 8000.0f, buf, i, n);
+        for (int k = 0; k < n; k++) {
+            float v = fminf(fmaxf(buf[k], -32768.0f), 32767.0f);
+            raw[i + k] = (int16_t)lrintf(v);
+            raw32[i + k] = raw[i + k];
+        }
+    }
+    
+    long long repeats = 100000000LL / samples + 1;
+    int max_threads = elec_get_worker_threads();
+    elec_set_worker_threads(1);
+    
+    SignalStats widened, exact16, exact32;
+    IntStats ist;
+    double elapsed[3];
+    for (int path = 0; path < 3; path++) {
+        double start = now_seconds();
+        for (long long r = 0; r < repeats; r++) {
+            if (path == 0) {
+                elec_stats_reset(&widened);
+                for (long long i = 0; i < samples; i += STREAM_CHUNK_SAMPLES) {
+                    int n = (samples - i < STREAM_CHUNK_SAMPLES) ? (int)(samples - i) : STREAM_CHUNK_SAMPLES;
+                    for (int k = 0; k < n; k++) {
+                        buf[k] = raw[i + k];
+                    }
+                    elec_stats_update(&widened, buf, n);
+                }
+            } else if (path == 1) {
+                elec_int_stats_i16(raw, samples, &ist);
+                elec_int_stats_volts(&ist, 1.0, 0.0, &exact16);
+            } else {
+                elec_int_stats_i32(raw32, samples, &ist);
+                elec_int_stats_volts(&ist, 1.0, 0.0, &exact32);
+            }
+            __asm__ volatile("" : : "r"(&ist), "r"(&widened) : "memory");
+        }
+        elapsed[path] = now_seconds() - start;
+    }
+    
+    static const char *paths[] = { "float", "int16", "int32" };
+    printf("%-6s %14s %8s  %s\n", "path", "samples/sec", "speedup", "rms / peak-to-peak / average");
+    const SignalStats *results[] = { &widened, &exact16, &exact32 };
+    for (int path = 0; path < 3; path++) {
+        printf("%-6s %14.0f %7.2fx  %.9g / %.9g / %.9g\n", paths[path], repeats * samples / elapsed[path],
+               elapsed[0] / elapsed[path], elec_calculate_rms(results[path]), elec_calculate_peak_to_peak(results[path]),
+               elec_calculate_average(results[path]));
+    }
+    
+    // The integer sums must not depend on the thread count
+    IntStats first;
+    int same = 1;
+    for (int threads = 1; ; ) {
+        elec_set_worker_threads(threads);
+        if (!elec_int_stats_parallel(raw, 16, samples, &ist)) {
+            same = 0;
+            break;
+        }
+        if (threads == 1) first = ist;
+        same = same && memcmp(&ist, &first, sizeof(ist)) == 0;
+        
+        if (threads == max_threads) break;
+        threads = (threads * 2 < max_threads) ? threads * 2 : max_threads;
+    }
+    elec_set_worker_threads(max_threads);
+    printf("\ninteger sums from 1 to %d threads: %s\n", max_threads, same ? "identical" : "MISMATCH");
+    
+    free(raw);
+    return 0;
+}
+
+// bench channels [samples] : per-channel statistics of interleaved frames
+// for 4 to 64 channels, one frame at a time (the original loop) against the
+// channel-group kernels on one thread and on the worker pool
+static int bench_channels(int samples) {
+    static const int counts[] = { 4, 8, 16, 24, 32, 64 };
+    float *values = malloc((size_t)samples * sizeof(float));
+    int16_t *counts16 = malloc((size_t)samples * sizeof(int16_t));
+    SignalStats *st = malloc(3 * 64 * sizeof(SignalStats));
+    IntStats *raw = malloc(64 * sizeof(IntStats));
+    if (values == NULL || counts16 == NULL || st == NULL || raw == NULL) {
+        free(values);
+        free(counts16);
+        free(st);
+        free(raw);
+        return batch_error("bench", "out of memory");
+    }
+    elec_fill_noise(elec_noise_gaussian, 1, 1.0f, values, samples);
+    for (int i = 0; i < samples; i++) {
+        counts16[i] = (int16_t)fmaxf(-32768.0f, fminf(32767.0f, values[i] * 4096.0f));
+    }
+    long long repeats = 50000000LL / samples + 1;
+    
+    printf("%8s %14s %14s %14s %8s %14s %14s  %s\n", "channels", "frame loop/s", "groups/s", "parallel/s", "speedup",
+           "frames/sec", "int16 par/s", "max rms difference");
+    for (int i = 0; i < (int)(sizeof(counts) / sizeof(counts[0])); i++) {
+        int channels = counts[i];
+        long long frames = samples / channels;
+        SignalStats *loop = st, *groups = st + 64, *parallel = st + 128;
+        double elapsed[3];
+        
+        for (int path = 0; path < 3; path++) {
+            double start = now_seconds();
+            for (long long r = 0; r < repeats; r++) {
+                if (path == 2) {
+                    if (!elec_stats_interleaved_parallel(values, channels, frames, parallel)) break;
+                    continue;
+                }
+                SignalStats *out = path ? groups : loop;
+                for (int c = 0; c < channels; c++) {
+                    elec_stats_reset(&out[c]);
+                }
+                if (path == 1) {
+                    elec_stats_update_interleaved(out, channels, values, frames);
+                    continue;
+                }
+                for (long long f = 0; f < frames; f++) {
+                    for (int c = 0; c < channels; c++) {
+                        float v = values[f * channels + c];
+                        out[c].count++;
+                        out[c].sum += v;
+                        out[c].sum_squares += (double)v * v;
+                        if (v < out[c].min) out[c].min = v;
+                        if (v > out[c].max) out[c].max = v;
+                    }
+                }
+            }
+            elapsed[path] = now_seconds() - start;
+        }
+        double start = now_seconds();
+        for (long long r = 0; r < repeats; r++) {
+            if (!elec_int_stats_interleaved_parallel(counts16, 16, channels, frames, raw)) break;
+        }
+        double int_elapsed = now_seconds() - start;
+        
+        double worst = 0.0;
+        for (int c = 0; c < channels; c++) {
+            double d = fmax(fabs(elec_calculate_rms(&groups[c]) - elec_calculate_rms(&loop[c])),
+                            fabs(elec_calculate_rms(&parallel[c]) - elec_calculate_rms(&loop[c])));
+            if (d > worst) worst = d;
+        }
+        double n = (double)repeats * frames * channels;
+        printf("%8d %14.0f %14.0f %14.0f %7.2fx %14.0f %14.0f  %.3g\n", channels, n / elapsed[0],
+               n / elapsed[1], n / elapsed[2], elapsed[0] / elapsed[2], repeats * frames / elapsed[2],
+               n / int_elapsed, worst);
+    }
+    
+    free(values);
+    free(counts16);
+    free(st);
+    free(raw);
+    return 0;
+}
+
+// A kernel timed by bench sweep, run on the first n samples of in
+typedef struct {
+    const char *name;
+    void (*run)(float *in, float *out, long long n, int arg);
+    int arg;
+    int prints;     // writes to stdout, which is sent to /dev/null while timed
+} BenchKernel;
+
+static void bench_stats_kernel(float *in, float *out, long long n, int arg) {
+    (void)arg;
+    SignalStats st;
+    elec_compute_stats_parallel(in, n, &st);
+    out[0] = elec_calculate_rms(&st) + elec_calculate_peak_to_peak(&st) + elec_calculate_average(&st);
+}
+
+static void bench_generate_kernel(float *in, float *out, long long n, int type) {
+    (void)in;
+    Waveform wave = { .samples = out, .count = (int)n, .amplitude = 1.0f, .frequency = 997.0f,
+                      .sample_rate = 48000.0f, .has_seed = 1, .seed = 42 };
+    generate_waveform(&wave, type);
+}
+
+static void bench_plot_kernel(float *in, float *out, long long n, int arg) {
+    (void)out;
+    (void)arg;
+    Waveform wave = { .samples = in, .count = (int)n, .amplitude = 1.0f, .frequency = 997.0f,
+                      .sample_rate = 48000.0f };
+    strcpy(wave.waveform_type, "Sine");
+    plot_waveform(&wave, 0);
+}
+
+static void bench_convert_kernel(float *in, float *out, long long n, int conversion) {
+    unit_conversions[conversion].convert_array(in, out, n);
+}
+
+static const BenchKernel bench_kernels[] = {
+    { "stats",    bench_stats_kernel,    0, 0 },    // rms, peak-to-peak and average
+    { "sine",     bench_generate_kernel, 1, 0 },
+    { "square",   bench_generate_kernel, 2, 0 },
+    { "triangle", bench_generate_kernel, 3, 0 },
+    { "noise",    bench_generate_kernel, 4, 0 },
+    { "gaussian", bench_generate_kernel, 5, 0 },
+    { "plot",     bench_plot_kernel,     0, 1 },
+    { "dbm2mw",   bench_convert_kernel,  0, 0 },
+    { "mw2dbm",   bench_convert_kernel,  1, 0 },
+    { "hz2rad",   bench_convert_kernel,  2, 0 },
+    { "rad2hz",   bench_convert_kernel,  3, 0 },
+    { "c2f",      bench_convert_kernel,  4, 0 },
+    { "f2c",      bench_convert_kernel,  5, 0 },
+};
+
+#define BENCH_KERNELS ((int)(sizeof(bench_kernels) / sizeof(bench_kernels[0])))
+
+// Mean, spread and extremes of the time per sample over repeated runs
+typedef struct {
+    long long calls;        // kernel calls per run
+    double mean, stddev, min, max;   // ns per sample
+} BenchTiming;
+
+// Time BENCH_RUNS runs of a kernel on n samples, each run calling it enough
+// times to cover BENCH_MIN_SAMPLES so that small sizes are above the clock
+// resolution. A first untimed call touches the buffers.
+static void bench_time(const BenchKernel *k, float *in, float *out, long long n, BenchTiming *t) {
+    int saved = k->prints ? mute_stdout() : -1;
+    
+    t->calls = (n < BENCH_MIN_SAMPLES) ? (BENCH_MIN_SAMPLES + n - 1) / n : 1;
+    k->run(in, out, n, k->arg);
+    
+    double ns[BENCH_RUNS], sum = 0.0;
+    for (int r = 0; r < BENCH_RUNS; r++) {
+        double start = now_seconds();
+        for (long long c = 0; c < t->calls; c++) {
+            k->run(in, out, n, k->arg);
+            __asm__ volatile("" : : "r"(out) : "memory");
+        }
+        ns[r] = (now_seconds() - start) * 1e9 / ((double)t->calls * n);
+        sum += ns[r];
+    }
+    
+    if (k->prints) unmute_stdout(saved);
+    
+    t->mean = sum / BENCH_RUNS;
+    t->min = t->max = ns[0];
+    double squares = 0.0;
+    for (int r = 0; r < BENCH_RUNS; r++) {
+        squares += (ns[r] - t->mean) * (ns[r] - t->mean);
+        if (ns[r] < t->min) t->min = ns[r];
+        if (ns[r] > t->max) t->max = ns[r];
+    }
+    t->stddev = sqrt(squares / (BENCH_RUNS - 1));
+}
+
+// bench sweep [max size] [results.json] : every kernel at sizes 10, 100, ...
+// up to max size, as ns/sample and throughput with the spread over runs,
+// optionally also written as JSON to compare builds
+static int bench_sweep(long long max_size, const char *json_path) {
+    float *in = malloc((size_t)max_size * sizeof(float));
+    float *out = malloc((size_t)max_size * sizeof(float));
+    if (in == NULL || out == NULL) {
+        free(in);
+        free(out);
+        return batch_error("bench", "out of memory");
+    }
+    // Positive, so that every conversion stays on its fast path
+    for (long long i = 0; i < max_size; i++) {
+        in[i] = 1.0f + 0.5f * sinf((float)(i % 4096) * (2.0f * (float)PI / 4096.0f));
+    }
+    
+    FILE *json = NULL;
+    if (json_path != NULL && (json = fopen(json_path, "w")) == NULL) {
+        free(in);
+        free(out);
+        return batch_error("bench", "cannot create JSON file");
+    }
+    if (json != NULL) {
+        fprintf(json, "{\n  \"timestamp\": %lld,\n  \"compiler\": \"%s\",\n  \"threads\": %d,\n"
+                      "  \"runs\": %d,\n  \"results\": [",
+                (long long)time(NULL), __VERSION__, elec_get_worker_threads(), BENCH_RUNS);
+    }
+    
+    printf("%-9s %10s %8s %12s %12s %8s %14s\n", "kernel", "size", "calls", "ns/sample", "stddev", "cv", "samples/sec");
+    int first = 1;
+    for (int k = 0; k < BENCH_KERNELS; k++) {
+        for (long long n = 10; ; n = (n * 10 < max_size) ? n * 10 : max_size) {
+            BenchTiming t;
+            bench_time(&bench_kernels[k], in, out, n, &t);
+            printf("%-9s %10lld %8lld %12.4f %12.4f %7.1f%% %14.0f\n", bench_kernels[k].name, n, t.calls,
+                   t.mean, t.stddev, 100.0 * t.stddev / t.mean, 1e9 / t.mean);
+            fflush(stdout);
+            if (json != NULL) {
+                fprintf(json, "%s\n    { \"kernel\": \"%s\", \"size\": %lld, \"calls\": %lld, "
+                              "\"ns_per_sample\": %.6g, \"ns_per_sample_min\": %.6g, \"ns_per_sample_max\": %.6g, "
+                              "\"ns_per_sample_stddev\": %.6g, \"ns_per_sample_variance\": %.6g, "
+                              "\"samples_per_sec\": %.6g }",
+                        first ? "" : ",", bench_kernels[k].name, n, t.calls, t.mean, t.min, t.max,
+                        t.stddev, t.stddev * t.stddev, 1e9 / t.mean);
+                first = 0;
+            }
+            if (n >= max_size) break;
+        }
+    }
+    
+    int failed = 0;
+    if (json != NULL) {
+        fprintf(json, "\n  ]\n}\n");
+        if (fclose(json) != 0) failed = batch_error("bench", "cannot write JSON file");
+    }
+    free(in);
+    free(out);
+    return failed;
+}
+
+// <name> [size], or sweep [max size] [results.json]
+static int run_bench(int argc, char **argv) {
+    if (strcmp(argv[0], "sweep") == 0) {
+        int max_size = 1000000;
+        if (argc > 3) return batch_error("bench", "usage: sweep [max size] [results.json]");
+        if (argc >= 2 && (!parse_int(argv[1], &max_size) || max_size < 10 || max_size > MAX_WAVE_SAMPLES)) {
+            return batch_error("bench", "max size must be between 10 and 100000000");
+        }
+        return bench_sweep(max_size, argc == 3 ? argv[2] : NULL);
+    }
+    if (argc > 2) return batch_error("bench", "usage: <name> [size]");
+    
+    int size = 100000;
+    if (argc == 2 && (!parse_int(argv[1], &size) || size <= 0)) {
+        return batch_error("bench", "invalid size");
+    }
+    if (strcmp(argv[0], "results") == 0) return bench_results(size);
+    if (strcmp(argv[0], "waveform") == 0) return bench_waveform(size);
+    if (strcmp(argv[0], "noise") == 0)    return bench_noise(size);
+    if (strcmp(argv[0], "threads") == 0)  return bench_threads(size);
+    if (strcmp(argv[0], "eseries") == 0)  return bench_eseries(size);
+    if (strcmp(argv[0], "bode") == 0)     return bench_bode(size);
+    if (strcmp(argv[0], "rcfilter") == 0) return bench_rcfilter(size);
+    if (strcmp(argv[0], "fft") == 0)      return bench_fft(size);
+    if (strcmp(argv[0], "monitor") == 0)  return bench_monitor(size);
+    if (strcmp(argv[0], "plot") == 0)     return bench_plot(size);
+    if (strcmp(argv[0], "export") == 0)   return bench_export(size);
+    if (strcmp(argv[0], "convert") == 0)  return bench_convert(size);
+    if (strcmp(argv[0], "arena") == 0)    return bench_arena(size);
+    if (strcmp(argv[0], "pipeline") == 0) return bench_pipeline(size);
+    if (strcmp(argv[0], "cache") == 0)    return bench_cache(size);
+    if (strcmp(argv[0], "capture") == 0)  return bench_capture(size);
+    if (strcmp(argv[0], "channels") == 0) return bench_channels(size);
+#ifdef __linux__
+    if (strcmp(argv[0], "serve") == 0)    return bench_serve(size);
+#endif
+    
+    return batch_error("bench", "unknown benchmark");
+}
+
+int main(int argc, char **argv) {
+    argc--;
+    argv++;
+    
+    // Leading options
+    while (argc >= 2 && strcmp(argv[0], "--threads") == 0) {
+        int threads;
+        if (!parse_int(argv[1], &threads) || threads < 1 || threads > ELEC_MAX_THREADS) {
+            return batch_error(argv[0], "thread count must be between 1 and 64");
+        }
+        elec_set_worker_threads(threads);
+        argc -= 2;
+        argv += 2;
+    }
+    configure_results("results.txt", RESULT_FORMAT_TEXT, RESULT_FLUSH_INTERVAL);
+    
+    if (argc == 0 || strcmp(argv[0], "help") == 0) {
+        fprintf(stderr,
+            "usage: bench.out [--threads N] <benchmark> [size]\n"
+            "  results [records] results log throughput\n"
+            "  waveform [samples] waveform synthesis speed and accuracy\n"
+            "  noise [samples]    noise generator speed and thread reproducibility\n"
+            "  threads [samples]  parallel analysis scaling (up to --threads)\n"
+            "  eseries [targets]  standard part selection speed\n"
+            "  bode [points]      frequency response sweep speed and accuracy\n"
+            "  rcfilter [samples] time-domain filter speed, single and multi-channel\n"
+            "  fft [samples]      FFT speed per size, accuracy and Welch throughput\n"
+            "  monitor [samples]  sliding-window statistics speed and accuracy\n"
+            "  plot [samples]     plot render time and spikes shown\n"
+            "  export [samples]   WAV/raw conversion speed and file write paths\n"
+            "  convert [values]   bulk unit conversion speed and dBm error bound\n"
+            "  sweep [max size] [results.json]  every kernel from 10 samples up, ns/sample and spread\n"
+            "  arena [samples]    repeated requests with malloc/free against the session arena\n"
+            "  pipeline [samples] stage-by-stage processing against the four-thread pipeline\n"
+            "  cache [samples]    repeated waveform requests with the result cache off and on\n"
+            "  capture [samples]  raw int16 capture statistics, widened to float against exact integer sums\n"
+            "  channels [samples] per-channel statistics of 4 to 64 interleaved channels\n"
+            "  serve [requests]   server round-trip latency with concurrent clients, against a process per request\n");
+        return argc == 0;
+    }
+    return run_bench(argc, argv) ? 1 : 0;
+}
@@ -0,0 +1,270 @@
+#ifndef ELEC_H
+#define ELEC_H
+
+/*
+ * ELEC2645 signal processing library: the analysis, filter, waveform and
+ * unit conversion cores of the calculator, without its menus or file I/O.
+ *
+ * Built as libelec.a and libelec.so ("make lib"). Every function works on
+ * buffers and objects the caller provides and never prints or reads input.
+ * Exported functions are named elec_* and macros ELEC_*; everything else in
+ * the library is static.
+ * Functions are reentrant and may be called from any number of threads
+ * on different objects. The only shared state is:
+ *   - the worker pool behind elec_parallel_for, the *_parallel functions,
+ *     elec_fill_noise and elec_evaluate_response. There is one pool per
+ *     process: elec_set_worker_threads changes the thread count for every
+ *     caller, and parallel calls from different threads are serialised (one
+ *     elec_parallel_for runs at a time, other callers wait for it to
+ *     finish). A task must not call elec_parallel_for itself. Callers that
+ *     need independent parallelism should run the single-threaded functions
+ *     on threads of their own,
+ *   - the cache of FFT tables, built once per size under a lock.
+ * Memory is allocated only by the *_init functions (released by the
+ * matching *_free), by elec_compute_stats_parallel,
+ * elec_int_stats_parallel, elec_stats_interleaved_parallel and
+ * elec_analyze_spectrum for scratch space, by elec_spectrum_finish, by the
+ * FFT table cache and by elec_arena_alloc. A SampleArena belongs to one
+ * session: it is not locked, so each thread should have its own.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define ELEC_ARENA_ALIGN 64             // sample buffers start on a cache line
+#define ELEC_MAX_THREADS 64
+#define ELEC_ANALYSIS_CHUNK (1 << 16)   // samples per parallel analysis task (256 KiB)
+#define ELEC_MAX_SLIDING_WINDOW (1 << 24)
+#define ELEC_MAX_SWEEP_POINTS 100000000
+#define ELEC_SWEEP_BLOCK 256            // frequency points per vectorized block
+#define ELEC_FFT_MIN_LOG 4              // smallest FFT: 16 points
+#define ELEC_FFT_MAX_LOG 24             // largest FFT: 16M points
+#define ELEC_FFT_BLOCK 2048             // complex points per cache-resident block of early stages
+#define ELEC_SPECTRUM_HARMONICS 10      // highest harmonic counted in THD
+
+// Reusable sample buffers with a cap on the memory held (see elec_arena_alloc)
+typedef struct ArenaBlock ArenaBlock;
+
+typedef struct {
+    size_t limit;           // most bytes held at once, 0 for no limit
+    size_t held;            // bytes of all buffers, in use or kept for reuse
+    size_t in_use;          // bytes of buffers handed out
+    size_t peak;            // largest held so far
+    long long allocations;  // buffers obtained from the system
+    long long reuses;       // requests served from kept buffers
+    ArenaBlock *kept;       // released buffers, most recent first
+    int kept_count;
+} SampleArena;
+
+// Running statistics for a stream of samples (O(1) memory). The extremes
+// are doubles so that those of integer captures stay exact.
+typedef struct {
+    long long count;
+    double sum;
+    double sum_squares;
+    double min;
+    double max;
+} SignalStats;
+
+// Exact statistics of integer samples, in sample units (see elec_int_stats_i16).
+// The sums are 128-bit two's complement integers, high word first.
+typedef struct {
+    long long count;
+    uint64_t sum[2];
+    uint64_t sum_squares[2];
+    int32_t min;
+    int32_t max;
+} IntStats;
+
+// Phase-accumulator oscillator (see elec_osc_init)
+typedef struct {
+    double phase;       // current phase in cycles, [0, 1)
+    double increment;   // cycles per sample
+    double cos_step;    // rotation by one step of the sine recurrences
+    double sin_step;
+} Oscillator;
+
+// Largest sample of a sliding window: a deque of samples in arrival order,
+// each larger than all that follow it, as a ring of window entries.
+// The smallest sample is tracked the same way with the values negated.
+typedef struct {
+    float *value;
+    long long *index;       // sample number of each entry
+    int head;
+    int len;
+} MonotonicQueue;
+
+// Statistics of the last window samples, updated sample by sample (see elec_sliding_update)
+typedef struct {
+    int window;
+    float *values;          // ring of the last window samples
+    int next;               // slot the next sample goes in (the oldest once full)
+    int held;               // samples in the ring
+    int since_resum;        // samples since the sums were recomputed
+    double sum;
+    double sum_squares;
+    MonotonicQueue max;
+    MonotonicQueue min;
+    long long count;        // samples pushed
+} SlidingStats;
+
+typedef struct {
+    float cutoff_freq;
+    float resistance;
+    float capacitance;
+    char type[20];          // "Low-Pass" or "High-Pass"
+} FilterConfig;
+
+// Log-spaced frequency grid for the response of a first-order RC filter
+typedef struct {
+    int is_lowpass;
+    double cutoff_freq;         // 1 / (2πRC) of the designed components
+    double start;               // first frequency, Hz
+    double stop;                // last frequency, Hz
+    double step;                // log10 spacing between points
+    long long points;
+    float powers[ELEC_SWEEP_BLOCK];  // 10^(k * step)
+} FrequencySweep;
+
+// Independent first-order RC filters, one per channel. Coefficients and
+// state are kept as arrays so that one time step of all channels is
+// computed together (see elec_filter_bank_run).
+typedef struct {
+    int channels;
+    double *decay;          // exp(-T / RC) per channel, T = 1 / sample rate
+    double *gain;           // (RC / T) (1 - decay)
+    double *highpass;       // 1 for a high-pass channel, 0 for low-pass
+    double *state;          // voltage across R at the previous sample
+    double *previous;       // previous input sample
+} FilterBank;
+
+// Cached tables for real FFTs of one size (see elec_get_fft_plan)
+typedef struct {
+    int size;               // real input points, a power of 2
+    double *twiddle_re;     // twiddles of each stage of the size/2 complex FFT
+    double *twiddle_im;
+    double *split_re;       // e^(-2πik/size), k < size/2, to split the complex result
+    double *split_im;
+} FftPlan;
+
+typedef enum { WINDOW_RECTANGULAR = 1, WINDOW_HANN = 2, WINDOW_BLACKMAN = 3 } WindowType;
+
+// Welch-averaged power spectrum of a signal fed in chunks: windowed
+// segments of size samples overlapping by half (see elec_spectrum_update)
+typedef struct {
+    const FftPlan *plan;
+    int size;
+    WindowType window;
+    double sample_rate;
+    double *window_values;  // size
+    double window_power;    // sum of squared window values
+    double *segment;        // size samples being collected
+    int held;               // samples in segment
+    double *re;             // size/2 each, FFT work space
+    double *im;
+    double *power;          // |X[k]|^2 summed over segments, k = 0..size/2
+    long long segments;
+    long long count;        // samples fed in
+} Spectrum;
+
+// Figures read from a spectrum
+typedef struct {
+    double frequency;       // dominant frequency, Hz (interpolated between bins)
+    double amplitude;       // its peak amplitude, V
+    double thd;             // harmonic to fundamental amplitude ratio
+    double snr_db;          // fundamental to noise power, harmonics excluded
+    int harmonics;          // harmonics below the Nyquist frequency
+} SpectralResult;
+
+typedef void (*ParallelTask)(void *arg, long long index);
+typedef void (*NoiseFill)(uint64_t seed, float amplitude, float *out, long long first, long long n);
+typedef void (*ConvertArray)(const float *restrict in, float *restrict out, long long n);
+
+/* Sample buffers: 64-byte aligned, reused across requests */
+void   elec_arena_init(SampleArena *arena, size_t limit);
+float *elec_arena_alloc(SampleArena *arena, long long count);
+void   elec_arena_release(SampleArena *arena, float *buffer);
+void   elec_arena_trim(SampleArena *arena);
+
+/* Worker pool, shared by the whole process (see above) */
+void elec_set_worker_threads(int threads);   /* 0 = one per CPU (the default) */
+int  elec_get_worker_threads(void);
+void elec_parallel_for(long long count, ParallelTask task, void *arg);
+
+/* Signal statistics */
+void  elec_stats_reset(SignalStats *st);
+void  elec_stats_merge(SignalStats *st, const SignalStats *part);
+void  elec_stats_reduce(SignalStats *parts, long long count, SignalStats *out);
+void  elec_compute_stats(const float *values, long long n, SignalStats *out);
+int   elec_compute_stats_parallel(const float *values, long long n, SignalStats *out);
+void  elec_stats_update(SignalStats *st, const float *values, long long n);
+void  elec_stats_update_interleaved(SignalStats *st, int channels, const float *values, long long frames);
+int   elec_stats_interleaved_parallel(const float *values, int channels, long long frames, SignalStats *out);
+float elec_calculate_rms(const SignalStats *st);
+float elec_calculate_peak_to_peak(const SignalStats *st);
+float elec_calculate_average(const SignalStats *st);
+
+/* Exact statistics of raw integer samples, scaled to volts at the end */
+void elec_int_stats_reset(IntStats *st);
+void elec_int_stats_merge(IntStats *st, const IntStats *part);
+void elec_int_stats_i16(const int16_t *values, long long n, IntStats *out);
+void elec_int_stats_i32(const int32_t *values, long long n, IntStats *out);
+int  elec_int_stats_parallel(const void *values, int bits, long long n, IntStats *out);
+void elec_int_stats_update_interleaved(IntStats *st, int bits, int channels, const void *values, long long frames);
+int  elec_int_stats_interleaved_parallel(const void *values, int bits, int channels, long long frames,
+                                         IntStats *out);
+void elec_int_stats_volts(const IntStats *st, double scale, double offset, SignalStats *out);
+
+/* Sliding-window statistics */
+int  elec_sliding_init(SlidingStats *ss, int window);
+void elec_sliding_free(SlidingStats *ss);
+void elec_sliding_update(SlidingStats *ss, const float *values, long long n);
+void elec_sliding_stats(const SlidingStats *ss, SignalStats *st);
+
+/* RC filter design, frequency response and time-domain filtering */
+int  elec_solve_filter(FilterConfig *filter, int is_lowpass, float cutoff_freq, int known, float value);
+int  elec_sweep_init(FrequencySweep *sweep, const FilterConfig *filter, double start, double stop, long long points);
+void elec_evaluate_response(const FrequencySweep *sweep, long long first, long long n,
+                       float *frequency, float *magnitude, float *phase);
+int  elec_filter_bank_init(FilterBank *bank, int channels);
+void elec_filter_bank_free(FilterBank *bank);
+void elec_filter_bank_set(FilterBank *bank, int channel, const FilterConfig *filter, double sample_rate);
+void elec_filter_bank_run(FilterBank *bank, const float *restrict in, float *restrict out, long long frames);
+
+/* Waveforms and noise */
+void elec_osc_init(Oscillator *osc, double frequency, double sample_rate);
+void elec_osc_advance(Oscillator *osc, long long n);
+void elec_osc_sine(Oscillator *osc, float amplitude, float *out, long long n);
+void elec_osc_square(Oscillator *osc, float amplitude, float *out, long long n);
+void elec_osc_triangle(Oscillator *osc, float amplitude, float *out, long long n);
+void elec_noise_uniform(uint64_t seed, float amplitude, float *out, long long first, long long n);
+void elec_noise_gaussian(uint64_t seed, float amplitude, float *out, long long first, long long n);
+void elec_fill_noise(NoiseFill fill, uint64_t seed, float amplitude, float *out, long long n);
+uint64_t elec_random_seed(void);
+
+/* FFT and spectrum analysis */
+const FftPlan *elec_get_fft_plan(int size);
+void elec_fft_complex(const FftPlan *plan, double *re, double *im);
+void elec_fft_complex_blocked(const FftPlan *plan, double *re, double *im, int block);
+void elec_fft_real_power(const FftPlan *plan, const double *re, const double *im, double *power);
+int  elec_spectrum_init(Spectrum *sp, int size, WindowType window, double sample_rate);
+void elec_spectrum_free(Spectrum *sp);
+void elec_spectrum_update(Spectrum *sp, const float *values, long long n);
+int  elec_spectrum_finish(Spectrum *sp);
+int  elec_analyze_spectrum(const Spectrum *sp, SpectralResult *res);
+
+/* Unit conversions, one value or n values (in and out must not overlap) */
+float elec_dbm_to_mw(float dbm);
+float elec_mw_to_dbm(float mw);
+float elec_hz_to_rad_s(float hz);
+float elec_rad_s_to_hz(float rad_s);
+float elec_celsius_to_fahrenheit(float c);
+float elec_fahrenheit_to_celsius(float f);
+void  elec_dbm_to_mw_array(const float *restrict in, float *restrict out, long long n);
+void  elec_mw_to_dbm_array(const float *restrict in, float *restrict out, long long n);
+void  elec_hz_to_rad_s_array(const float *restrict in, float *restrict out, long long n);
+void  elec_rad_s_to_hz_array(const float *restrict in, float *restrict out, long long n);
+void  elec_celsius_to_fahrenheit_array(const float *restrict in, float *restrict out, long long n);
+void  elec_fahrenheit_to_celsius_array(const float *restrict in, float *restrict out, long long n);
+
+#endif /* ELEC_H */
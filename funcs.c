@@ -6,40 +6,278 @@
 #include <string.h>
 #include <math.h>
 #include <ctype.h>
+#include <strings.h>
+#include <time.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <pthread.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#ifdef __linux__
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
 #include "funcs.h"
+#include "elec.h"
 
 // CONTANTS
 #define PI 3.14159265359
 #define SPEED_OF_LIGHT 299792458.0f
-#define MAX_SAMPLES 50
-#define PLOT_WIDTH 60
+#define PLOT_WIDTH 60               // default plot size
 #define PLOT_HEIGHT 20
+#define MAX_PLOT_WIDTH 1000
+#define MAX_PLOT_HEIGHT 200
+#define MAX_WAVE_SAMPLES 100000000
+#define SESSION_MEMORY_LIMIT (2048LL << 20)  // default cap on sample buffers held (--memory)
+#define CACHE_MEMORY_LIMIT (64LL << 20)     // default memory budget of the result cache (--cache)
+#define CACHE_BUCKETS 4096
+#define CACHE_MAGIC "ELECC002"  // file format and result version: bump when a cached result changes
+#define MAX_EXPORT_SAMPLES 2000000000  // streamed exports are not held in memory
+#define EXPORT_CHUNK (1 << 16)         // samples per parallel conversion task (even)
+#define EXPORT_WINDOW (1 << 22)        // samples converted per write or mapping
+#define EXPORT_MMAP_MIN (64LL << 20)   // bytes from which the output is mapped
+#define WAV_HEADER_SIZE 44
+#define SWEEP_WINDOW (1 << 20)     // points evaluated per write of a sweep
+#define FILTER_CHUNK (1 << 14)     // samples per filtering pass of a long signal
+#define MAX_CHANNELS 1024          // channels of an interleaved signal
+#define PIPE_BLOCK 4096            // samples per pipeline block (a multiple of 512, see pipe_generate)
+#define PIPE_SLOTS 8               // blocks per pipeline ring (a power of 2)
+#define PIPE_SPIN 100              // polls of a full or empty ring before sleeping
+#define TEXT_BUFFER_SIZE (1 << 20)
+#define STREAM_CHUNK_SAMPLES 4096
+#define RESULT_BUFFER_SIZE (1 << 16)
+#define RESULT_RECORD_MAX 256
+#define RESULT_FLUSH_INTERVAL 1.0   // seconds between flushes within a batch job
+#define RESULT_BINARY_MAGIC "ELECRES1"
+#define CAPTURE_MAGIC "SIGC"
+#define RES_FIRST_DECADE 1     // standard resistors 10 Ω ...
+#define RES_LAST_DECADE 7      // ... 9.76 MΩ
+#define CAP_FIRST_DECADE -12   // standard capacitors 1 pF ...
+#define CAP_LAST_DECADE -3     // ... 976 µF
+#define E_SERIES_MAX 96
 
 // DATA STRUCTURES
 typedef struct {
-    float values[MAX_SAMPLES];
+    float *values;          // count samples, see alloc_signal()
     int count;
     float sample_rate;
 } SignalData;
 
+// Buffered reader for numeric text (see text_reader_read)
 typedef struct {
-    float cutoff_freq;
-    float resistance;
-    float capacitance;
-    char type[20];
-} FilterConfig;
+    FILE *in;
+    char *buf;              // TEXT_BUFFER_SIZE + 1 bytes
+    size_t len;             // bytes in buf
+    size_t limit;           // end of the last complete number in buf
+    size_t pos;             // parse position
+    int eof;
+    int live;               // hand out samples as they arrive (see text_reader_fill)
+    long long line;         // current line, from 1
+    size_t line_start;      // offset of the current line in buf ...
+    long long column_base;  // ... plus columns of it already discarded
+    const char *error;      // set when a read fails
+    long long error_line;
+    long long error_column;
+} TextReader;
+
+// Standard component values of one E-series
+typedef struct {
+    const char *name;
+    const double *mantissas;   // values in [1, 10)
+    int count;
+    double resistors[E_SERIES_MAX * (RES_LAST_DECADE - RES_FIRST_DECADE)];   // sorted
+    int resistor_count;
+    double capacitors[E_SERIES_MAX * (CAP_LAST_DECADE - CAP_FIRST_DECADE)];  // sorted
+    int capacitor_count;
+} ESeries;
+
+// Nearest standard R/C pair for a target cutoff
+typedef struct {
+    double target;
+    double resistance;
+    double capacitance;
+    double actual;          // cutoff the pair really gives
+    double error;           // (actual - target) / target
+} ComponentMatch;
+
+// Sample formats of exported waveforms
+typedef enum { EXPORT_PCM16 = 1, EXPORT_PCM24 = 2, EXPORT_PCM32 = 3, EXPORT_FLOAT = 4, EXPORT_RAW = 5 } ExportFormat;
+
+// Sample formats of binary capture files
+typedef enum { SAMPLE_F32 = 1, SAMPLE_I16 = 2, SAMPLE_I32 = 3 } SampleFormat;
+
+// Optional 32-byte header at the start of a capture file (little endian)
+typedef struct {
+    char magic[4];          // CAPTURE_MAGIC
+    uint32_t format;        // SampleFormat
+    double sample_rate;     // Hz
+    double scale;           // volts per sample unit
+    double offset;          // volts added after scaling
+} CaptureHeader;
+
+// A memory-mapped capture file
+typedef struct {
+    int fd;
+    void *map;
+    size_t map_size;
+    const void *data;       // first sample, after any header
+    long long count;
+    SampleFormat format;
+    int has_header;
+    double sample_rate;     // from the header, if any
+    double scale;
+    double offset;
+} Capture;
+
+// Kinds of logged result
+enum { RESULT_ANALYSIS = 1, RESULT_WAVEFORM = 2, RESULT_SPECTRUM = 3 };
+
+typedef enum {
+    RESULT_FORMAT_TEXT,     // human readable lines (the original results.txt)
+    RESULT_FORMAT_CSV,      // one CSV row per record, with a header line
+    RESULT_FORMAT_BINARY    // RESULT_BINARY_MAGIC then ResultRecord structs
+} ResultFormat;
+
+// One logged result. This is also the 40-byte binary record layout (native
+// endian, no padding): analysis values are rms, peak-to-peak, average,
+// labelled with the channel of a multi-channel signal; waveform values are
+// frequency, amplitude; spectrum values are dominant frequency, THD (%),
+// SNR (dB), with the window as label.
+typedef struct {
+    int64_t count;
+    uint32_t kind;
+    char label[16];
+    float values[3];
+} ResultRecord;
 
+// Open results file plus pending output
 typedef struct {
-    float samples[200];
+    const char *path;
+    ResultFormat format;
+    double flush_interval;
+    double last_flush;
+    int fd;
+    size_t used;
+    char buf[RESULT_BUFFER_SIZE];
+} ResultSink;
+
+// Samples to be filtered: a text stream or a mapped capture
+typedef struct {
+    TextReader *reader;     // text input, or NULL for the capture
+    const Capture *capture;
+    long long next;         // next capture sample
+} SampleSource;
+
+typedef struct {
+    float *samples;         // count samples, see alloc_waveform()
     int count;
     float amplitude;
     float frequency;
     float sample_rate;
     char waveform_type[20];
+    uint64_t seed;          // noise seed, used as given when has_seed is set
+    int has_seed;
 } Waveform;
 
+// Kinds of cached result
+typedef enum { CACHE_WAVEFORM = 1, CACHE_PLOT, CACHE_FILTER } CacheKind;
+
+// Normalized parameters of a cached request, hashed and compared as bytes
+// (see waveform_key), so unused fields must be 0
+typedef struct {
+    uint32_t kind;          // CacheKind
+    uint32_t type;          // waveform type (as generate_waveform), or 1 for a low-pass filter
+    int64_t count;          // samples
+    uint64_t seed;          // noise only
+    float params[3];        // amplitude, frequency, sample rate, or cutoff and known value
+    int32_t known;          // filter: 1 = R, 2 = C
+    int32_t width;          // plot size
+    int32_t height;
+} CacheKey;
+
+// One cached result, in the LRU list and in a hash chain
+typedef struct CacheEntry {
+    CacheKey key;
+    uint64_t hash;
+    size_t size;
+    struct CacheEntry *prev;    // more recently used
+    struct CacheEntry *next;    // less recently used
+    struct CacheEntry *chain;   // next in the same bucket
+    unsigned char data[];       // size bytes
+} CacheEntry;
+
+typedef struct {
+    size_t budget;              // most bytes held in memory (--cache), 0 for none
+    size_t used;
+    const char *dir;            // disk tier (--cache-dir), NULL for none
+    long long hits;
+    long long disk_hits;
+    long long misses;
+    long long evictions;
+    long long entries;
+    CacheEntry *newest;
+    CacheEntry *oldest;
+    CacheEntry *buckets[CACHE_BUCKETS];
+    void *spill;                // loaded from disk but too big to hold, see cache_load
+} ResultCache;
+
+static ResultSink results_sink = { "results.txt", RESULT_FORMAT_TEXT, 0.0, 0.0, -1, 0, { 0 } };
+
+// Sample buffers of signals and waveforms, reused from request to request
+static SampleArena session_arena = { .limit = SESSION_MEMORY_LIMIT };
+
+// Results of earlier requests (see cache_get)
+static ResultCache result_cache = { .budget = CACHE_MEMORY_LIMIT };
+
 // UTILITY FUNCTIONS
 
+// Parse a whole string as a float (surrounding blanks allowed)
+static int parse_float(const char *s, float *value) {
+    const char *start = s;
+    while (*start == ' ' || *start == '\t')
+        start++;
+
+    char *endptr;
+    *value = strtof(start, &endptr);
+
+    while (*endptr == ' ' || *endptr == '\t')
+        endptr++;
+    
+    return endptr != start && *endptr == '\0';
+}
+
+// Parse a whole string as an integer (surrounding blanks allowed)
+static int parse_int(const char *s, int *value) {
+    const char *start = s;
+    while (*start == ' ' || *start == '\t')
+        start++;
+
+    char *endptr;
+    long val = strtol(start, &endptr, 10);
+
+    while (*endptr == ' ' || *endptr == '\t')
+        endptr++;
+
+    if (endptr == start || *endptr != '\0') {
+        return 0;
+    }
+    
+    *value = (int)val;
+    return 1;
+}
+
 // Get a float value with validation
 static int get_float(const char *prompt, float *value) {
     char buf[64];
@@ -51,17 +289,7 @@ static int get_float(const char *prompt, float *value) {
     
     buf[strcspn(buf, "\r\n")] = '\0';
     
-    char *start = buf;
-    while (*start == ' ' || *start == '\t')
-        start++;
-
-    char *endptr;
-    *value = strtof(buf, &endptr);
-
-    while (*endptr == ' ' || *endptr == '\t')
-        endptr++;
-    
-    if (endptr == start || *endptr != '\0') {
+    if (!parse_float(buf, value)) {
         printf("Invalid number!\n");
         return 0;
     }
@@ -80,25 +308,33 @@ static int get_int(const char *prompt, int *value) {
     
     buf[strcspn(buf, "\r\n")] = '\0';
     
-    char *start = buf;
-    while (*start == ' ' || *start == '\t')
-        start++;
-
-    char *endptr;
-    long val = strtol(start, &endptr, 10);
-
-    while (*endptr == ' ' || *endptr == '\t')
-        endptr++;
-
-    if (endptr == start || *endptr != '\0') {
+    if (!parse_int(buf, value)) {
         printf("Invalid integer!\n");
         return 0;
     }
     
-    *value = (int)val;
     return 1;
 }
 
+// Get a line of text (e.g. a file name) with the newline stripped
+static int get_line(const char *prompt, char *buf, int size) {
+    printf("%s", prompt);
+    
+    if (!fgets(buf, size, stdin)) {
+        return 0;
+    }
+    
+    buf[strcspn(buf, "\r\n")] = '\0';
+    return 1;
+}
+
+// Seconds from a monotonic clock, for throughput measurements
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
 // Print a separator line
 static void print_separator(void) {
     printf("========================================================\n");
@@ -112,484 +348,4535 @@ static void print_header(const char *title) {
     print_separator();
 }
 
-// Save result to file
-static void save_result(const char *text) {
-    FILE *f = fopen("results.txt", "a");
-    if (f != NULL) {
-        fprintf(f, "%s\n", text);
-        fclose(f);
-    }
-}
-
-// SIGNAL ANALYSIS FUNCTIONS
+// RESULTS SINK
+//
+// Results are appended to results.txt through one file that stays open,
+// with records collected in a large buffer. The buffer is written out when
+// it fills, when the flush interval has passed, and at exit.
 
-// Calculate RMS (Root Mean Square) of a signal
-static float calculate_rms(SignalData *sig) {
-    if (sig->count == 0) return 0.0f;
-    
-    float sum_squares = 0.0f;
-    for (int i = 0; i < sig->count; i++) {
-        sum_squares += sig->values[i] * sig->values[i];
+// Append whole buffer to a file descriptor
+static int write_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        data += n;
+        len -= (size_t)n;
     }
-    
-    return sqrtf(sum_squares / sig->count);
+    return 1;
 }
 
-// Calculate peak-to-peak amplitude
-static float calculate_peak_to_peak(SignalData *sig) {
-    if (sig->count == 0) return 0.0f;
-    
-    float min = sig->values[0];
-    float max = sig->values[0];
-    
-    for (int i = 1; i < sig->count; i++) {
-        if (sig->values[i] < min) min = sig->values[i];
-        if (sig->values[i] > max) max = sig->values[i];
+// Write out everything buffered so far
+static void flush_results(void) {
+    if (results_sink.fd >= 0 && results_sink.used > 0) {
+        write_all(results_sink.fd, results_sink.buf, results_sink.used);
     }
-    
-    return max - min;
+    results_sink.used = 0;
+    results_sink.last_flush = now_seconds();
 }
 
-// Calculate average (DC component)
-static float calculate_average(SignalData *sig) {
-    if (sig->count == 0) return 0.0f;
-    
-    float sum = 0.0f;
-    for (int i = 0; i < sig->count; i++) {
-        sum += sig->values[i];
+static void close_results(void) {
+    flush_results();
+    if (results_sink.fd >= 0) {
+        close(results_sink.fd);
+        results_sink.fd = -1;
     }
-    
-    return sum / sig->count;
 }
 
-// FILTER DESIGN FUNCTIONS
+// Choose where and how results are logged (before the first result).
+// flush_interval is in seconds; 0 writes every record straight through.
+static void configure_results(const char *path, ResultFormat format, double flush_interval) {
+    close_results();
+    results_sink.path = path;
+    results_sink.format = format;
+    results_sink.flush_interval = flush_interval;
+}
 
-// Design RC filter with flexible known parameter
-static void design_filter(FilterConfig *filter, int is_lowpass) {
-    if (is_lowpass) {
-        printf("\nRC Low-Pass Filter Design\n");
-        strcpy(filter->type, "Low-Pass");
-    } else {
-        printf("\nRC High-Pass Filter Design\n");
-        strcpy(filter->type, "High-Pass");
-    }
+// Open the results file on first use, writing a header for new CSV/binary files
+static int open_results(void) {
+    static int registered = 0;
+    if (results_sink.fd >= 0) return 1;
     
-    printf("Formula: fc = 1 / (2πRC)\n\n");
-    
-    if (!get_float("Enter cutoff frequency (Hz): ", &filter->cutoff_freq)) return;
-    
-    if (filter->cutoff_freq <= 0) {
-        printf("Frequency must be positive!\n");
-        return;
+    results_sink.fd = open(results_sink.path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (results_sink.fd < 0) return 0;
+    if (!registered) {
+        atexit(close_results);
+        registered = 1;
     }
+    results_sink.used = 0;
+    results_sink.last_flush = now_seconds();
     
-    printf("\nWhat is known?\n");
-    printf("  1. Resistance (R)\n");
-    printf("  2. Capacitance (C)\n");
-    
-    int known;
-    if (!get_int("\nChoice: ", &known)) return;
-    
-    if (known == 1) {
-        // Known: R, calculate C
-        if (!get_float("\nEnter resistance (Ω): ", &filter->resistance)) return;
-        
-        if (filter->resistance <= 0) {
-            printf("Resistance must be positive!\n");
-            return;
-        }
-        
-        // C = 1 / (2π * R * fc)
-        filter->capacitance = 1.0f / (2.0f * PI * filter->resistance * filter->cutoff_freq);
-        
-    } else if (known == 2) {
-        // Known: C, calculate R
-        if (!get_float("\nEnter capacitance (F, e.g. 1e-6): ", &filter->capacitance)) return;
-        
-        if (filter->capacitance <= 0) {
-            printf("Capacitance must be positive!\n");
-            return;
+    struct stat info;
+    if (fstat(results_sink.fd, &info) == 0 && info.st_size == 0) {
+        if (results_sink.format == RESULT_FORMAT_CSV) {
+            const char *header = "kind,waveform,samples,rms,peak_to_peak,average,frequency,amplitude,thd_percent,snr_db\n";
+            memcpy(results_sink.buf, header, strlen(header));
+            results_sink.used = strlen(header);
+        } else if (results_sink.format == RESULT_FORMAT_BINARY) {
+            memcpy(results_sink.buf, RESULT_BINARY_MAGIC, 8);
+            results_sink.used = 8;
         }
-        
-        // R = 1 / (2π * C * fc)
-        filter->resistance = 1.0f / (2.0f * PI * filter->capacitance * filter->cutoff_freq);
-        
-    } else {
-        printf("Invalid choice!\n");
-        return;
     }
+    return 1;
 }
 
-// Display filter design results
-static void display_filter_results(FilterConfig *filter) {
-    printf("\n");
-    print_header("FILTER DESIGN RESULTS");
+// Format one record in the sink's format; returns its length in bytes
+static int format_result(const ResultRecord *rec, char *out, size_t size) {
+    const float *v = rec->values;
     
-    printf("  Type:           %s\n", filter->type);
-    printf("  Cutoff (-3dB):  %.2f Hz\n", filter->cutoff_freq);
-    printf("  Resistance:     %.2f Ω", filter->resistance);
-    if (filter->resistance > 1000) {
-        printf(" (%.2f kΩ)", filter->resistance / 1000.0f);
+    switch (results_sink.format) {
+        case RESULT_FORMAT_BINARY:
+            memcpy(out, rec, sizeof(*rec));
+            return sizeof(*rec);
+            
+        case RESULT_FORMAT_CSV:
+            if (rec->kind == RESULT_ANALYSIS) {
+                return snprintf(out, size, "analysis,%s,%lld,%.4f,%.4f,%.4f,,,,\n",
+                    rec->label, (long long)rec->count, v[0], v[1], v[2]);
+            }
+            if (rec->kind == RESULT_SPECTRUM) {
+                return snprintf(out, size, "spectrum,%s,%lld,,,,%.4f,,%.4f,%.2f\n",
+                    rec->label, (long long)rec->count, v[0], v[1], v[2]);
+            }
+            return snprintf(out, size, "waveform,%s,%lld,,,,%.2f,%.2f,,\n",
+                rec->label, (long long)rec->count, v[0], v[1]);
+            
+        default:
+            if (rec->kind == RESULT_ANALYSIS && rec->label[0] != '\0') {
+                return snprintf(out, size,
+                    "Signal Analysis (%s): RMS=%.4f V, Peak-to-Peak=%.4f V, Average=%.4f V, Samples=%lld\n",
+                    rec->label, v[0], v[1], v[2], (long long)rec->count);
+            }
+            if (rec->kind == RESULT_ANALYSIS) {
+                return snprintf(out, size,
+                    "Signal Analysis: RMS=%.4f V, Peak-to-Peak=%.4f V, Average=%.4f V\n",
+                    v[0], v[1], v[2]);
+            }
+            if (rec->kind == RESULT_SPECTRUM) {
+                return snprintf(out, size,
+                    "Spectral Analysis: %s window, Dominant=%.4f Hz, THD=%.4f %%, SNR=%.2f dB, Samples=%lld\n",
+                    rec->label, v[0], v[1], v[2], (long long)rec->count);
+            }
+            return snprintf(out, size, "Waveform Generated: %s, Freq=%.2f Hz, Amp=%.2f, Samples=%lld\n",
+                rec->label, v[0], v[1], (long long)rec->count);
     }
-    printf("\n");
+}
+
+// Save result to file
+static void save_result(const ResultRecord *rec) {
+    if (!open_results()) return;
     
-    printf("  Capacitance:    %.9f F\n", filter->capacitance);
-    if (filter->capacitance >= 1e-6) {
-        printf("                  %.2f µF\n", filter->capacitance * 1e6);
-    } else if (filter->capacitance >= 1e-9) {
-        printf("                  %.2f nF\n", filter->capacitance * 1e9);
-    } else {
-        printf("                  %.2f pF\n", filter->capacitance * 1e12);
+    if (results_sink.used + RESULT_RECORD_MAX > RESULT_BUFFER_SIZE) {
+        flush_results();
+    }
+    int len = format_result(rec, results_sink.buf + results_sink.used, RESULT_RECORD_MAX);
+    if (len > 0) {
+        results_sink.used += (size_t)len < RESULT_RECORD_MAX ? (size_t)len : RESULT_RECORD_MAX - 1;
     }
     
-    float tau = filter->resistance * filter->capacitance;
-    printf("  Time Constant:  %.6f s", tau);
-    if (tau < 1e-3) {
-        printf(" (%.2f µs)", tau * 1e6);
-    } else if (tau < 1.0) {
-        printf(" (%.2f ms)", tau * 1e3);
+    if (now_seconds() - results_sink.last_flush >= results_sink.flush_interval) {
+        flush_results();
     }
-    printf("\n");
-    print_separator();
 }
 
-// WAVEFORM GENERATION FUNCTIONS
+// Save a signal analysis summary
+static void save_analysis_result(long long count, float rms, float pk_pk, float avg) {
+    ResultRecord rec = { .kind = RESULT_ANALYSIS, .count = count, .values = { rms, pk_pk, avg } };
+    save_result(&rec);
+}
 
-// Generate sine wave 
-static void generate_sine(Waveform *wave) {
-    for (int i = 0; i < wave->count; i++) {
-        float t = (float)i / wave->sample_rate;
-        wave->samples[i] = wave->amplitude * sinf(2.0f * PI * wave->frequency * t);
+// Save the analysis of one channel of a multi-channel signal
+static void save_channel_result(int channel, const SignalStats *st) {
+    ResultRecord rec = { .kind = RESULT_ANALYSIS, .count = st->count,
+                         .values = { elec_calculate_rms(st), elec_calculate_peak_to_peak(st), elec_calculate_average(st) } };
+    snprintf(rec.label, sizeof(rec.label), "ch%d", channel);
+    save_result(&rec);
+}
+
+// Save a generated waveform summary
+static void save_waveform_result(const Waveform *wave) {
+    ResultRecord rec = { .kind = RESULT_WAVEFORM, .count = wave->count,
+                         .values = { wave->frequency, wave->amplitude } };
+    snprintf(rec.label, sizeof(rec.label), "%.*s", (int)sizeof(rec.label) - 1, wave->waveform_type);
+    save_result(&rec);
+}
+
+// Save a spectral analysis summary
+static void save_spectrum_result(long long count, const char *window, float frequency, float thd_percent, float snr_db) {
+    ResultRecord rec = { .kind = RESULT_SPECTRUM, .count = count, .values = { frequency, thd_percent, snr_db } };
+    snprintf(rec.label, sizeof(rec.label), "%.*s", (int)sizeof(rec.label) - 1, window);
+    save_result(&rec);
+}
+
+// RESULT CACHE
+//
+// Generated samples, rendered plots and filter designs are kept for the
+// next identical request, keyed on the request's parameters (see
+// CacheKey). The memory tier holds the most recently used entries within a
+// budget (--cache MB); with --cache-dir, entries are also written to files
+// named after the key's hash, so they last across runs. The cache is used
+// by the main thread only and is not locked.
+
+// FNV-1a hash of a key
+static uint64_t cache_hash(const CacheKey *key) {
+    const unsigned char *p = (const unsigned char *)key;
+    uint64_t h = 0xCBF29CE484222325ULL;
+    for (size_t i = 0; i < sizeof(*key); i++) {
+        h = (h ^ p[i]) * 0x100000001B3ULL;
     }
+    return h;
 }
 
-// Generate square wave
-static void generate_square(Waveform *wave) {
-    for (int i = 0; i < wave->count; i++) {
-        float t = (float)i / wave->sample_rate;
-        float phase = fmodf(wave->frequency * t, 1.0f);
-        wave->samples[i] = (phase < 0.5f) ? wave->amplitude : -wave->amplitude;
+static void cache_unlink(CacheEntry *e) {
+    if (e->prev != NULL) {
+        e->prev->next = e->next;
+    } else {
+        result_cache.newest = e->next;
+    }
+    if (e->next != NULL) {
+        e->next->prev = e->prev;
+    } else {
+        result_cache.oldest = e->prev;
     }
 }
 
-// Generate triangle wave
-static void generate_triangle(Waveform *wave) {
-    for (int i = 0; i < wave->count; i++) {
-        float t = (float)i / wave->sample_rate;
-        float phase = fmodf(wave->frequency * t, 1.0f);
-        wave->samples[i] = wave->amplitude * (4.0f * fabsf(phase - 0.5f) - 1.0f);
+static void cache_push_newest(CacheEntry *e) {
+    e->prev = NULL;
+    e->next = result_cache.newest;
+    if (e->next != NULL) e->next->prev = e;
+    result_cache.newest = e;
+    if (result_cache.oldest == NULL) result_cache.oldest = e;
+}
+
+// Drop the least recently used entry
+static void cache_drop_oldest(void) {
+    CacheEntry *e = result_cache.oldest;
+    cache_unlink(e);
+    CacheEntry **link = &result_cache.buckets[e->hash % CACHE_BUCKETS];
+    while (*link != e) link = &(*link)->chain;
+    *link = e->chain;
+    result_cache.used -= sizeof(CacheEntry) + e->size;
+    result_cache.entries--;
+    result_cache.evictions++;
+    free(e);
+}
+
+// Make room for bytes more (at most the budget) in the memory tier
+static void cache_evict(size_t bytes) {
+    while (result_cache.oldest != NULL && result_cache.used > result_cache.budget - bytes) {
+        cache_drop_oldest();
     }
 }
 
-// Generate noise
-static void generate_noise(Waveform *wave) {
-    for (int i = 0; i < wave->count; i++) {
-        wave->samples[i] = wave->amplitude * (2.0f * ((float)rand() / RAND_MAX) - 1.0f);
+// Keep a copy of size bytes in the memory tier, if they fit in the budget
+static void cache_hold(const CacheKey *key, uint64_t hash, const void *data, size_t size) {
+    size_t bytes = sizeof(CacheEntry) + size;
+    if (bytes > result_cache.budget) return;
+    cache_evict(bytes);
+    CacheEntry *e = malloc(bytes);
+    if (e == NULL) return;
+    e->key = *key;
+    e->hash = hash;
+    e->size = size;
+    memcpy(e->data, data, size);
+    e->chain = result_cache.buckets[hash % CACHE_BUCKETS];
+    result_cache.buckets[hash % CACHE_BUCKETS] = e;
+    cache_push_newest(e);
+    result_cache.used += bytes;
+    result_cache.entries++;
+}
+
+// File of a key in the disk tier
+static void cache_path(uint64_t hash, char *path, size_t size) {
+    snprintf(path, size, "%s/%016llx.cache", result_cache.dir, (unsigned long long)hash);
+}
+
+// Read an entry from the disk tier, holding it in the memory tier (or, if
+// it does not fit there, until the next cache_get). Returns its data, or
+// NULL if there is no file, it does not match the key or its size is not
+// between min_size and max_size (checked before anything is allocated).
+static const void *cache_load(const CacheKey *key, uint64_t hash, size_t min_size, size_t max_size,
+                              size_t *size) {
+    char path[4096];
+    cache_path(hash, path, sizeof(path));
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) return NULL;
+    
+    char magic[8];
+    CacheKey stored;
+    uint64_t stored_size;
+    void *data = NULL;
+    if (fread(magic, sizeof(magic), 1, f) == 1 && memcmp(magic, CACHE_MAGIC, sizeof(magic)) == 0 &&
+        fread(&stored, sizeof(stored), 1, f) == 1 && memcmp(&stored, key, sizeof(stored)) == 0 &&
+        fread(&stored_size, sizeof(stored_size), 1, f) == 1 &&
+        stored_size >= min_size && stored_size <= max_size &&
+        (data = malloc(stored_size > 0 ? stored_size : 1)) != NULL && fread(data, 1, stored_size, f) != stored_size) {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    if (data == NULL) return NULL;
+    
+    *size = stored_size;
+    cache_hold(key, hash, data, stored_size);
+    CacheEntry *e = result_cache.newest;
+    if (e != NULL && e->hash == hash && memcmp(&e->key, key, sizeof(*key)) == 0) {
+        free(data);
+        return e->data;
     }
+    result_cache.spill = data;
+    return data;
 }
 
-// ASCII visualization of waveform
-static void plot_waveform(Waveform *wave) {
-    printf("\n");
-    print_header("WAVEFORM VISUALIZATION");
+// Cached data of a key and its size, or NULL on a miss. An entry whose size
+// is not between min_size and max_size is a miss. The data stays valid
+// until the next cache_get or cache_put.
+static const void *cache_get(const CacheKey *key, size_t min_size, size_t max_size, size_t *size) {
+    free(result_cache.spill);
+    result_cache.spill = NULL;
+    if (result_cache.budget == 0 && result_cache.dir == NULL) return NULL;
     
-    // Find min and max for scaling
-    float min_val = wave->samples[0];
-    float max_val = wave->samples[0];
-    for (int i = 1; i < wave->count; i++) {
-        if (wave->samples[i] < min_val) min_val = wave->samples[i];
-        if (wave->samples[i] > max_val) max_val = wave->samples[i];
+    uint64_t hash = cache_hash(key);
+    CacheEntry *e = result_cache.buckets[hash % CACHE_BUCKETS];
+    while (e != NULL && (e->hash != hash || memcmp(&e->key, key, sizeof(*key)) != 0)) {
+        e = e->chain;
+    }
+    if (e != NULL && e->size >= min_size && e->size <= max_size) {
+        cache_unlink(e);
+        cache_push_newest(e);
+        result_cache.hits++;
+        *size = e->size;
+        return e->data;
+    }
+    const void *data = (e == NULL && result_cache.dir != NULL) ? cache_load(key, hash, min_size, max_size, size)
+                                                               : NULL;
+    if (data != NULL) {
+        result_cache.disk_hits++;
+    } else {
+        result_cache.misses++;
     }
+    return data;
+}
+
+// Keep size bytes of data under a key, and write them to the disk tier.
+// The file is written under a temporary name and renamed into place, so
+// that another run never reads half of it.
+static void cache_put(const CacheKey *key, const void *data, size_t size) {
+    if (result_cache.budget == 0 && result_cache.dir == NULL) return;
+    uint64_t hash = cache_hash(key);
+    cache_hold(key, hash, data, size);
+    if (result_cache.dir == NULL) return;
     
-    // Add margin
-    float margin = (max_val - min_val) * 0.1f;
-    min_val -= margin;
-    max_val += margin;
+    char path[4096], temp[4200];
+    cache_path(hash, path, sizeof(path));
+    snprintf(temp, sizeof(temp), "%s.%ld.tmp", path, (long)getpid());
+    FILE *f = fopen(temp, "wb");
+    if (f == NULL) return;
+    uint64_t stored_size = size;
+    int ok = fwrite(CACHE_MAGIC, 8, 1, f) == 1 && fwrite(key, sizeof(*key), 1, f) == 1 &&
+             fwrite(&stored_size, sizeof(stored_size), 1, f) == 1 && fwrite(data, 1, size, f) == size;
+    if (fclose(f) != 0) ok = 0;
+    if (!ok || rename(temp, path) != 0) unlink(temp);
+}
+
+// TEXT INPUT FUNCTIONS
+//
+// Bulk reader for numbers separated by newlines, commas, semicolons or
+// blanks. Input is read in large blocks and parsed in place by a hand-rolled
+// decimal parser; only the tail of a block that may hold a cut-off number
+// is carried over to the next read.
+
+// Powers of ten that are exact in float (5^10 < 2^24)
+static const float exact_powers_of_ten[] = {
+    1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+};
+
+static inline int is_separator(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == ',' || c == ';';
+}
+
+// Fast path for plain decimals: [+-]digits[.digits][e[+-]digits] whose
+// digits make an integer of at most 2^24 and whose exponent is at most 10
+// either way. Both are then exact in float, so one float multiply or divide
+// gives the correctly rounded result, the same as strtof.
+// Returns the end of the number, or NULL to leave it to strtof.
+static const char *scan_decimal(const char *p, float *value) {
+    int negative = 0;
+    if (*p == '-' || *p == '+') negative = (*p++ == '-');
+    if (p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) return NULL;    // hex, for strtof
     
-    float range = max_val - min_val;
-    if (range < 1e-6f) range = 1.0f;
+    uint64_t mantissa = 0;
+    int digits = 0;        // significant digits taken into mantissa
+    int exponent = 0;      // decimal exponent adjustment
+    int seen = 0;          // any digit at all
     
-    // Determine samples to plot (subsample if needed)
-    int step = (wave->count > PLOT_WIDTH) ? (wave->count / PLOT_WIDTH) : 1;
-    int plot_samples = (wave->count + step - 1) / step;
+    while (*p == '0') { p++; seen = 1; }
+    for (; (unsigned)(*p - '0') < 10; p++, seen = 1) {
+        if (digits == 19) return NULL;
+        mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+        digits++;
+    }
+    if (*p == '.') {
+        p++;
+        if (digits == 0) {
+            while (*p == '0') { p++; exponent--; seen = 1; }
+        }
+        for (; (unsigned)(*p - '0') < 10; p++, seen = 1) {
+            if (digits == 19) return NULL;
+            mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+            digits++;
+            exponent--;
+        }
+    }
+    if (!seen) return NULL;
     
-    // Plot from top to bottom
-    for (int row = 0; row < PLOT_HEIGHT; row++) {
-        float y_level = max_val - (row * range / (PLOT_HEIGHT - 1));
-        
-        printf("|");
-        for (int col = 0; col < plot_samples && col * step < wave->count; col++) {
-            float sample = wave->samples[col * step];
-            
-            // Check if sample is at this height level
-            float tolerance = range / (PLOT_HEIGHT * 2);
-            if (fabsf(sample - y_level) < tolerance) {
-                printf("*");
-            } else if (row == PLOT_HEIGHT / 2) {
-                // Zero line
-                printf("-");
-            } else {
-                printf(" ");
-            }
+    if (*p == 'e' || *p == 'E') {
+        p++;
+        int exp_negative = 0;
+        if (*p == '-' || *p == '+') exp_negative = (*p++ == '-');
+        if ((unsigned)(*p - '0') >= 10) return NULL;
+        int e = 0;
+        for (; (unsigned)(*p - '0') < 10; p++) {
+            if (e < 10000) e = e * 10 + (*p - '0');
         }
-        printf("\n");
+        exponent += exp_negative ? -e : e;
     }
     
-    // Print axis
-    printf("+");
-    for (int i = 0; i < plot_samples; i++) printf("-");
-    printf("\n");
+    if (mantissa > (1u << 24) || exponent < -10 || exponent > 10) return NULL;
     
-    printf("\nWaveform: %s, Freq: %.2f Hz, Amp: %.2f, Samples: %d\n", 
-           wave->waveform_type, wave->frequency, wave->amplitude, wave->count);
-    print_separator();
+    float v = (float)mantissa;
+    v = (exponent < 0) ? v / exact_powers_of_ten[-exponent] : v * exact_powers_of_ten[exponent];
+    *value = negative ? -v : v;
+    return p;
 }
 
-// UNIT CONVERSION FUNCTIONS
-
-// Power conversions
-static float dbm_to_mw(float dbm) {
-    return powf(10.0f, dbm / 10.0f);
+// Parse a number starting at p (anything strtof accepts).
+// Returns the end of the number, or NULL if there is no number at p.
+static const char *scan_float(const char *p, float *value) {
+    const char *end = scan_decimal(p, value);
+    if (end != NULL) return end;
+    
+    char *slow_end;
+    float v = strtof(p, &slow_end);
+    if (slow_end == p) return NULL;
+    *value = v;
+    return slow_end;
 }
 
-static float mw_to_dbm(float mw) {
-    return 10.0f * log10f(mw);
+// Set up a reader on an open stream
+static int text_reader_init(TextReader *r, FILE *in) {
+    memset(r, 0, sizeof(*r));
+    r->in = in;
+    r->line = 1;
+    r->buf = malloc(TEXT_BUFFER_SIZE + 1);
+    return r->buf != NULL;
 }
 
-// Frequency conversions
-static float hz_to_rad_s(float hz) {
-    return 2.0f * PI * hz;
+static void text_reader_free(TextReader *r) {
+    free(r->buf);
+    r->buf = NULL;
 }
 
-static float rad_s_to_hz(float rad_s) {
-    return rad_s / (2.0f * PI);
+// Record a parse error at buffer offset pos
+static long long text_reader_fail(TextReader *r, const char *message, size_t pos) {
+    r->error = message;
+    r->error_line = r->line;
+    r->error_column = r->column_base + (long long)(pos - r->line_start) + 1;
+    return -1;
 }
 
-// Temperature conversions 
-static float celsius_to_fahrenheit(float c) {
-    return (c * 9.0f / 5.0f) + 32.0f;
+// Keep the unparsed tail, read more and find the last complete number.
+// Returns -1 on error.
+static int text_reader_fill(TextReader *r) {
+    size_t held = r->len - r->pos;
+    if (r->line_start >= r->pos) {
+        r->line_start -= r->pos;
+    } else {
+        r->column_base += (long long)(r->pos - r->line_start);
+        r->line_start = 0;
+    }
+    memmove(r->buf, r->buf + r->pos, held);
+    r->pos = 0;
+    
+    // A live reader takes whatever one read() returns rather than waiting
+    // for a full buffer, so it must be on a stream not read through stdio
+    size_t got;
+    if (r->live) {
+        ssize_t n;
+        do {
+            n = read(fileno(r->in), r->buf + held, TEXT_BUFFER_SIZE - held);
+        } while (n < 0 && errno == EINTR);
+        if (n < 0) return (int)text_reader_fail(r, "Read error", 0);
+        got = (size_t)n;
+    } else {
+        got = fread(r->buf + held, 1, TEXT_BUFFER_SIZE - held, r->in);
+        if (got == 0 && ferror(r->in)) return (int)text_reader_fail(r, "Read error", 0);
+    }
+    r->len = held + got;
+    if (got == 0) r->eof = 1;
+    r->buf[r->len] = '\0';
+    
+    // Only parse up to the last separator; the tail may be a partial number,
+    // completed by the next fill
+    r->limit = r->len;
+    if (!r->eof) {
+        while (r->limit > 0 && !is_separator(r->buf[r->limit - 1]))
+            r->limit--;
+        if (r->limit == 0 && r->len == TEXT_BUFFER_SIZE) return (int)text_reader_fail(r, "Number too long", 0);
+    }
+    return 1;
 }
 
-static float fahrenheit_to_celsius(float f) {
-    return (f - 32.0f) * 5.0f / 9.0f;
+// Read up to max numbers. Returns how many were read (0 at end of input),
+// or -1 with r->error, r->error_line and r->error_column set. A live reader
+// returns early with the numbers received so far rather than wait for more.
+static long long text_reader_read(TextReader *r, float *out, long long max) {
+    long long count = 0;
+    
+    while (count < max) {
+        // Skip separators, counting lines
+        while (r->pos < r->limit && is_separator(r->buf[r->pos])) {
+            if (r->buf[r->pos] == '\n') {
+                r->line++;
+                r->line_start = r->pos + 1;
+                r->column_base = 0;
+            }
+            r->pos++;
+        }
+        if (r->pos >= r->limit) {
+            if (r->eof || (r->live && count > 0)) break;
+            if (text_reader_fill(r) < 0) return -1;
+            continue;
+        }
+        
+        const char *start = r->buf + r->pos;
+        const char *end = scan_float(start, &out[count]);
+        if (end == NULL || !(is_separator(*end) || *end == '\0')) {
+            return text_reader_fail(r, "Invalid number", r->pos);
+        }
+        r->pos += (size_t)(end - start);
+        count++;
+    }
+    return count;
 }
 
-// ==================== MENU ITEM IMPLEMENTATIONS ====================
+// STREAMING ANALYSIS FUNCTIONS
 
-/* Menu Item 1: Unit Converter */
-void menu_item_1(void) {
-    print_header("ENGINEERING UNIT CONVERTER");
+// Read samples from a text stream in large buffered chunks and fold them
+// into the statistics without storing them. Returns 1 on success, 0 with
+// the reader error filled in otherwise.
+static int stream_signal(FILE *in, SignalStats *st, TextReader *reader) {
+    float chunk[STREAM_CHUNK_SAMPLES];
     
-    printf("\nSelect conversion:\n");
-    printf("  1. dBm ↔ mW (Power)\n");
-    printf("  2. Hz ↔ rad/s (Frequency)\n");
-    printf("  3. °C ↔ °F (Temperature)\n");
+    elec_stats_reset(st);
+    if (!text_reader_init(reader, in)) {
+        reader->error = "Out of memory";
+        return 0;
+    }
     
-    int type;
-    if (!get_int("\nChoice: ", &type)) return;
+    long long n;
+    while ((n = text_reader_read(reader, chunk, STREAM_CHUNK_SAMPLES)) > 0) {
+        elec_stats_update(st, chunk, n);
+    }
     
-    int direction;
-    float input, result;
+    text_reader_free(reader);
+    return n == 0;
+}
+
+// SLIDING WINDOW FUNCTIONS (the window itself is in elec.c)
+
+// Push a text stream through the window, writing sample-number rms average
+// peak-to-peak to out after every decimation samples (bare numbers, or
+// aligned columns for the terminal). Output is flushed whenever the reader
+// runs out of input, so a live reader shows each line as soon as it is due.
+// Returns 1 at the end of input, 0 with the reader error set.
+static int monitor_stream(TextReader *reader, SlidingStats *ss, long long decimation, FILE *out, int bare) {
+    float chunk[STREAM_CHUNK_SAMPLES];
+    long long due = decimation;
+    long long n;
     
-    switch (type) {
-        case 1: // Power
-            printf("\n1=dBm→mW, 2=mW→dBm: ");
-            if (!get_int("", &direction)) return;
-            
-            if (direction == 1) {
-                if (!get_float("Enter power (dBm): ", &input)) return;
-                result = dbm_to_mw(input);
-                printf("\n%.2f dBm = %.6f mW = %.6f W\n", input, result, result/1000.0f);
-            } 
-            else if (direction == 2) {
-                if (!get_float("Enter power (mW): ", &input)) return;
-                result = mw_to_dbm(input);
-                printf("\n%.6f mW = %.2f dBm\n", input, result);
-            }
-            else {
-                printf("Invalid direction!\n");
-                return;
-            }
-            break;
-            
-        case 2: // Frequency
-            printf("\n1=Hz→rad/s, 2=rad/s→Hz: ");
-            if (!get_int("", &direction)) return;
-            
-            if (direction == 1) {
-                if (!get_float("Enter frequency (Hz): ", &input)) return;
-                result = hz_to_rad_s(input);
-                printf("\n%.2f Hz = %.4f rad/s\n", input, result);
-            } else if (direction == 2) {
-                if (!get_float("Enter angular frequency (rad/s): ", &input)) return;
-                result = rad_s_to_hz(input);
-                printf("\n%.4f rad/s = %.2f Hz\n", input, result);
-            }
-            else {
-                printf("Invalid direction!\n");
-                return;
-            }
-            break;
-            
-        case 3: // Temperature
-            printf("\n1=°C→°F, 2=°F→°C: ");
-            if (!get_int("", &direction)) return;
-            
-            if (direction == 1) {
-                if (!get_float("Enter temperature (°C): ", &input)) return;
-                result = celsius_to_fahrenheit(input);
-                printf("\n%.2f°C = %.2f°F\n", input, result);
-            } else if (direction == 2) {
-                if (!get_float("Enter temperature (°F): ", &input)) return;
-                result = fahrenheit_to_celsius(input);
-                printf("\n%.2f°F = %.2f°C\n", input, result);
-            }
-            else {
-                printf("Invalid direction!\n");
-                return;
-            }
-            break;
+    while ((n = text_reader_read(reader, chunk, STREAM_CHUNK_SAMPLES)) > 0) {
+        for (long long i = 0; i < n; ) {
+            long long take = (n - i < due) ? n - i : due;
+            elec_sliding_update(ss, chunk + i, take);
+            i += take;
+            if ((due -= take) > 0) continue;
+            due = decimation;
             
-        default:
-            printf("Invalid choice!\n");
+            SignalStats st;
+            elec_sliding_stats(ss, &st);
+            fprintf(out, bare ? "%lld %.7g %.7g %.7g\n" : "%12lld %12.4f %12.4f %12.4f\n", ss->count,
+                    elec_calculate_rms(&st), elec_calculate_average(&st), elec_calculate_peak_to_peak(&st));
+        }
+        if (reader->live || n < STREAM_CHUNK_SAMPLES) fflush(out);
     }
+    fflush(out);
+    return n == 0;
 }
 
-/* Menu Item 2: RC Filter Designer */
-void menu_item_2(void) {
-    print_header("RC FILTER DESIGNER");
+// CAPTURE FILE FUNCTIONS
+//
+// Raw little-endian float32, int16 or int32 captures are memory-mapped and
+// analysed in place, with no copy and no text parsing. A file may start with a
+// CaptureHeader giving its format, sample rate and scaling; otherwise these
+// come from the caller. Mapped pages are only cached by the kernel, so files
+// larger than RAM are fine.
+
+static void close_capture(Capture *cap);
+
+// Open and map a capture. Returns NULL on success or an error message.
+static const char *open_capture(const char *path, SampleFormat format, double scale, double offset,
+                                Capture *cap) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+    return "Captures can only be read on little-endian machines";
+#endif
+    memset(cap, 0, sizeof(*cap));
+    cap->fd = -1;
+    cap->format = format;
+    cap->scale = scale;
+    cap->offset = offset;
     
-    FilterConfig filter;
+    cap->fd = open(path, O_RDONLY);
+    if (cap->fd < 0) return "Cannot open capture file";
     
-    printf("\nSelect filter type:\n");
-    printf("  1. Low-Pass Filter\n");
-    printf("  2. High-Pass Filter\n");
+    struct stat info;
+    if (fstat(cap->fd, &info) != 0) {
+        close_capture(cap);
+        return "Cannot read capture file";
+    }
+    cap->map_size = (size_t)info.st_size;
     
-    int choice;
-    if (!get_int("\nChoice: ", &choice)) return;
+    if (cap->map_size > 0) {
+        cap->map = mmap(NULL, cap->map_size, PROT_READ, MAP_PRIVATE, cap->fd, 0);
+        if (cap->map == MAP_FAILED) {
+            cap->map = NULL;
+            close_capture(cap);
+            return "Cannot map capture file";
+        }
+        madvise(cap->map, cap->map_size, MADV_SEQUENTIAL);
+    }
     
-    if (choice == 1) {
-        design_filter(&filter, 1);  // Low-pass
-    } else if (choice == 2) {
-        design_filter(&filter, 0);  // High-pass
+    const char *data = cap->map;
+    size_t size = cap->map_size;
+    if (size >= sizeof(CaptureHeader) && memcmp(data, CAPTURE_MAGIC, 4) == 0) {
+        CaptureHeader header;
+        memcpy(&header, data, sizeof(header));
+        if (header.format < SAMPLE_F32 || header.format > SAMPLE_I32) {
+            close_capture(cap);
+            return "Unknown sample format in capture header";
+        }
+        cap->has_header = 1;
+        cap->format = (SampleFormat)header.format;
+        cap->sample_rate = header.sample_rate;
+        cap->scale = header.scale;
+        cap->offset = header.offset;
+        data += sizeof(header);
+        size -= sizeof(header);
+    }
+    
+    // A partial last sample means the file was cut short
+    size_t width = (cap->format == SAMPLE_I16) ? sizeof(int16_t) : sizeof(float);
+    if (size % width != 0) {
+        close_capture(cap);
+        return "Capture file ends in a partial sample (truncated?)";
+    }
+    cap->data = data;
+    cap->count = (long long)(size / width);
+    return NULL;
+}
+
+static void close_capture(Capture *cap) {
+    if (cap->map != NULL) munmap(cap->map, cap->map_size);
+    if (cap->fd >= 0) close(cap->fd);
+    cap->map = NULL;
+    cap->fd = -1;
+}
+
+// Sample format by batch name (f32, i16 or i32)
+static int parse_sample_format(const char *name, SampleFormat *format) {
+    if (strcmp(name, "f32") == 0) {
+        *format = SAMPLE_F32;
+    } else if (strcmp(name, "i16") == 0) {
+        *format = SAMPLE_I16;
+    } else if (strcmp(name, "i32") == 0) {
+        *format = SAMPLE_I32;
     } else {
-        printf("Invalid choice!\n");
-        return;
+        return 0;
     }
+    return 1;
+}
+
+// Apply v -> scale * v + offset to statistics taken on raw values
+static void stats_scale(SignalStats *st, double scale, double offset) {
+    double n = (double)st->count;
+    st->sum_squares = scale * scale * st->sum_squares + 2.0 * scale * offset * st->sum + n * offset * offset;
+    st->sum = scale * st->sum + n * offset;
     
-    display_filter_results(&filter);
+    double lo = scale * st->min + offset;
+    double hi = scale * st->max + offset;
+    st->min = (lo < hi) ? lo : hi;
+    st->max = (lo < hi) ? hi : lo;
 }
 
-/* Menu Item 3: Signal Analysis */
-void menu_item_3(void) {
-    print_header("SIGNAL ANALYSIS");
+// Statistics of a whole capture, in volts. Returns 0 if out of memory.
+static int analyze_capture(const Capture *cap, SignalStats *out) {
+    if (cap->count == 0) {
+        elec_stats_reset(out);
+        return 1;
+    }
     
-    SignalData signal;
-    signal.count = 0;
+    // Integer samples are summed exactly as integers and scaled once
+    if (cap->format != SAMPLE_F32) {
+        IntStats raw;
+        if (!elec_int_stats_parallel(cap->data, (cap->format == SAMPLE_I16) ? 16 : 32, cap->count, &raw)) return 0;
+        elec_int_stats_volts(&raw, cap->scale, cap->offset, out);
+        return 1;
+    }
     
-    printf("\nAnalyze signal properties (RMS, Peak-to-Peak, Average)\n");
+    if (!elec_compute_stats_parallel(cap->data, cap->count, out)) return 0;
+    if (cap->scale != 1.0 || cap->offset != 0.0) {
+        stats_scale(out, cap->scale, cap->offset);
+    }
+    return 1;
+}
+
+// FILTER DESIGN FUNCTIONS
+
+// elec_solve_filter, reusing the design of an identical earlier request
+static int solve_filter_cached(FilterConfig *filter, int is_lowpass, float cutoff_freq, int known, float value) {
+    CacheKey key;
+    memset(&key, 0, sizeof(key));
+    key.kind = CACHE_FILTER;
+    key.type = (uint32_t)(is_lowpass != 0);
+    key.known = known;
+    key.params[0] = cutoff_freq;
+    key.params[1] = value;
     
-    if (!get_float("Enter sample rate (Hz): ", &signal.sample_rate)) return;
-    if (!get_int("Enter number of samples (1-50): ", &signal.count)) return;
+    size_t size;
+    const void *design = cache_get(&key, sizeof(*filter), sizeof(*filter), &size);
+    if (design != NULL) {
+        memcpy(filter, design, sizeof(*filter));
+        return 1;
+    }
+    if (!elec_solve_filter(filter, is_lowpass, cutoff_freq, known, value)) return 0;
+    cache_put(&key, filter, sizeof(*filter));
+    return 1;
+}
+
+// Design RC filter with flexible known parameter
+static int design_filter(FilterConfig *filter, int is_lowpass) {
+    if (is_lowpass) {
+        printf("\nRC Low-Pass Filter Design\n");
+    } else {
+        printf("\nRC High-Pass Filter Design\n");
+    }
     
-    if (signal.count <= 0 || signal.count > MAX_SAMPLES) {
-        printf("Invalid sample count!\n");
-        return;
+    printf("Formula: fc = 1 / (2πRC)\n\n");
+    
+    float cutoff_freq;
+    if (!get_float("Enter cutoff frequency (Hz): ", &cutoff_freq)) return 0;
+    
+    if (cutoff_freq <= 0) {
+        printf("Frequency must be positive!\n");
+        return 0;
     }
     
-    printf("\nEnter %d voltage values:\n", signal.count);
-    for (int i = 0; i < signal.count; i++) {
-        char prompt[64];
-        snprintf(prompt, sizeof(prompt), "  V[%d]: ", i);
-        if (!get_float(prompt, &signal.values[i])) {
-            printf("Aborting.\n");
-            return;
+    printf("\nWhat is known?\n");
+    printf("  1. Resistance (R)\n");
+    printf("  2. Capacitance (C)\n");
+    
+    int known;
+    if (!get_int("\nChoice: ", &known)) return 0;
+    
+    float value;
+    if (known == 1) {
+        if (!get_float("\nEnter resistance (Ω): ", &value)) return 0;
+        
+        if (value <= 0) {
+            printf("Resistance must be positive!\n");
+            return 0;
+        }
+    } else if (known == 2) {
+        if (!get_float("\nEnter capacitance (F, e.g. 1e-6): ", &value)) return 0;
+        
+        if (value <= 0) {
+            printf("Capacitance must be positive!\n");
+            return 0;
         }
+    } else {
+        printf("Invalid choice!\n");
+        return 0;
     }
     
-    // Calculate and display results
-    float rms = calculate_rms(&signal);
-    float pk_pk = calculate_peak_to_peak(&signal);
-    float avg = calculate_average(&signal);
+    return solve_filter_cached(filter, is_lowpass, cutoff_freq, known, value);
+}
+
+// STANDARD COMPONENT SELECTION
+//
+// Picks the standard E12/E24/E96 resistor and capacitor pair whose RC
+// product gives the cutoff closest to a target. The component tables are
+// built once, sorted, and searched by bisection: for each standard R that
+// can be used, the best C is the neighbour of 1/(2π R fc) in the table.
+
+static const double e12_values[] = {
+    1.0, 1.2, 1.5, 1.8, 2.2, 2.7, 3.3, 3.9, 4.7, 5.6, 6.8, 8.2
+};
+
+static const double e24_values[] = {
+    1.0, 1.1, 1.2, 1.3, 1.5, 1.6, 1.8, 2.0, 2.2, 2.4, 2.7, 3.0,
+    3.3, 3.6, 3.9, 4.3, 4.7, 5.1, 5.6, 6.2, 6.8, 7.5, 8.2, 9.1
+};
+
+static const double e96_values[] = {
+    1.00, 1.02, 1.05, 1.07, 1.10, 1.13, 1.15, 1.18, 1.21, 1.24, 1.27, 1.30,
+    1.33, 1.37, 1.40, 1.43, 1.47, 1.50, 1.54, 1.58, 1.62, 1.65, 1.69, 1.74,
+    1.78, 1.82, 1.87, 1.91, 1.96, 2.00, 2.05, 2.10, 2.15, 2.21, 2.26, 2.32,
+    2.37, 2.43, 2.49, 2.55, 2.61, 2.67, 2.74, 2.80, 2.87, 2.94, 3.01, 3.09,
+    3.16, 3.24, 3.32, 3.40, 3.48, 3.57, 3.65, 3.74, 3.83, 3.92, 4.02, 4.12,
+    4.22, 4.32, 4.42, 4.53, 4.64, 4.75, 4.87, 4.99, 5.11, 5.23, 5.36, 5.49,
+    5.62, 5.76, 5.90, 6.04, 6.19, 6.34, 6.49, 6.65, 6.81, 6.98, 7.15, 7.32,
+    7.50, 7.68, 7.87, 8.06, 8.25, 8.45, 8.66, 8.87, 9.09, 9.31, 9.53, 9.76
+};
+
+static ESeries e_series[] = {
+    { "E12", e12_values, 12, { 0 }, 0, { 0 }, 0 },
+    { "E24", e24_values, 24, { 0 }, 0, { 0 }, 0 },
+    { "E96", e96_values, 96, { 0 }, 0, { 0 }, 0 },
+};
+
+// Fill table with mantissa * 10^d for each decade in [first_decade, last_decade)
+static int build_component_table(const ESeries *series, int first_decade, int last_decade, double *table) {
+    int n = 0;
+    for (int d = first_decade; d < last_decade; d++) {
+        for (int i = 0; i < series->count; i++) {
+            table[n++] = series->mantissas[i] * pow(10.0, d);
+        }
+    }
+    return n;
+}
+
+// Look up a series by name ("E12", "e24", ...), building its tables on first use
+static const ESeries *find_e_series(const char *name) {
+    static pthread_mutex_t build_lock = PTHREAD_MUTEX_INITIALIZER;
     
-    printf("\n");
-    print_header("ANALYSIS RESULTS");
-    printf("  Samples:        %d\n", signal.count);
-    printf("  Sample Rate:    %.2f Hz\n", signal.sample_rate);
-    printf("  RMS Value:      %.4f V\n", rms);
-    printf("  Peak-to-Peak:   %.4f V\n", pk_pk);
-    printf("  Average (DC):   %.4f V\n", avg);
-    print_separator();
+    for (size_t s = 0; s < sizeof(e_series) / sizeof(e_series[0]); s++) {
+        ESeries *series = &e_series[s];
+        if (strcasecmp(name, series->name) != 0) continue;
+        
+        pthread_mutex_lock(&build_lock);
+        if (series->resistor_count == 0) {
+            series->capacitor_count = build_component_table(series, CAP_FIRST_DECADE, CAP_LAST_DECADE,
+                                                            series->capacitors);
+            series->resistor_count = build_component_table(series, RES_FIRST_DECADE, RES_LAST_DECADE,
+                                                           series->resistors);
+        }
+        pthread_mutex_unlock(&build_lock);
+        return series;
+    }
+    return NULL;
+}
 
-    char buf[256];
-    snprintf(buf, sizeof(buf), 
-        "Signal Analysis: RMS=%.4f V, Peak-to-Peak=%.4f V, Average=%.4f V", rms, pk_pk, avg);
-    save_result(buf);
+// Index of the first table entry >= value (count if none)
+static int lower_bound(const double *table, int count, double value) {
+    int lo = 0, hi = count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (table[mid] < value) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
 }
 
-/* Menu Item 4: Waveform Generator */
-void menu_item_4(void) {
-    print_header("WAVEFORM GENERATOR");
+// Best standard R/C pair for one target cutoff, searching the full tables.
+// Used when the target is so extreme that the component ranges matter.
+static void match_components_full(const ESeries *series, double target, ComponentMatch *match) {
+    double product = 1.0 / (2.0 * PI * target);   // required R * C
+    const double *caps = series->capacitors;
+    int cap_count = series->capacitor_count;
     
-    Waveform wave;
+    // Only resistors whose ideal capacitor lies within (or next to) the table
+    int first = lower_bound(series->resistors, series->resistor_count, product / caps[cap_count - 1]);
+    int last = lower_bound(series->resistors, series->resistor_count, product / caps[0]);
+    if (first > 0) first--;
+    if (last >= series->resistor_count) last = series->resistor_count - 1;
     
-    printf("\nSelect waveform type:\n");
-    printf("  1. Sine Wave\n");
-    printf("  2. Square Wave\n");
-    printf("  3. Triangle Wave\n");
-    printf("  4. Noise\n");
+    double best_error = INFINITY;
+    for (int r = first; r <= last; r++) {
+        double resistance = series->resistors[r];
+        int c = lower_bound(caps, cap_count, product / resistance);
+        
+        for (int k = c - 1; k <= c; k++) {
+            if (k < 0 || k >= cap_count) continue;
+            double error = fabs(product / (resistance * caps[k]) - 1.0);
+            if (error < best_error) {
+                best_error = error;
+                match->resistance = resistance;
+                match->capacitance = caps[k];
+            }
+        }
+    }
+}
+
+// Range of resistor decades that keep R and C inside their tables when
+// R*C = mantissas * 10^total. Returns 0 if there is none.
+static int decade_range(int total, int *lowest, int *highest) {
+    *lowest = RES_FIRST_DECADE;
+    if (total - (CAP_LAST_DECADE - 1) > *lowest) *lowest = total - (CAP_LAST_DECADE - 1);
+    *highest = RES_LAST_DECADE - 1;
+    if (total - CAP_FIRST_DECADE < *highest) *highest = total - CAP_FIRST_DECADE;
+    return *lowest <= *highest;
+}
+
+// Best standard R/C pair for one target cutoff.
+// The E-series repeat every decade, so only the mantissas matter: for each
+// resistor mantissa the nearest capacitor mantissa is found by bisection,
+// then the best pair is placed in decades with R as close to 10 kΩ as the
+// component ranges allow.
+static void match_components(const ESeries *series, double target, ComponentMatch *match) {
+    double product = 1.0 / (2.0 * PI * target);   // required R * C
+    int exponent = (int)floor(log10(product));
+    double mantissa = product / pow(10.0, exponent);   // in [1, 10)
+    const double *m = series->mantissas;
+    int count = series->count;
     
-    int type;
-    if (!get_int("\nChoice: ", &type)) return;
+    double best_error = INFINITY;
+    double best_unplaceable = INFINITY;   // best pair that cannot fit the ranges
+    double best_r = 1.0, best_c = 1.0;
+    int best_total = 0;                   // decade exponent of R*C
     
-    if (type < 1 || type > 4) {
-        printf("Invalid choice!\n");
-        return;
+    for (int r = 0; r < count; r++) {
+        double ideal = mantissa / m[r];    // in (0.1, 10)
+        int shift = 0;
+        if (ideal < 1.0) {
+            ideal *= 10.0;
+            shift = -1;
+        }
+        
+        int lo = 0, hi = count;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (m[mid] < ideal) lo = mid + 1;
+            else hi = mid;
+        }
+        
+        // Neighbours lo-1 and lo; past the end wraps to the next decade
+        for (int k = lo - 1; k <= lo; k++) {
+            if (k < 0) continue;
+            int wrap = (k == count);
+            double cap = wrap ? 10.0 * m[0] : m[k];
+            double error = fabs(ideal / cap - 1.0);
+            if (error >= best_error) continue;
+            
+            int total = exponent + shift + wrap;
+            int lowest, highest;
+            if (!decade_range(total, &lowest, &highest)) {
+                if (error < best_unplaceable) best_unplaceable = error;
+                continue;
+            }
+            best_error = error;
+            best_r = m[r];
+            best_c = wrap ? m[0] : m[k];
+            best_total = total;
+        }
     }
     
+    match->target = target;
+    if (best_unplaceable < best_error) {
+        match_components_full(series, target, match);
+    } else {
+        int lowest, highest;
+        decade_range(best_total, &lowest, &highest);
+        int decade = (best_r < 3.16) ? 4 : 3;   // R between ~3 kΩ and ~30 kΩ
+        if (decade < lowest) decade = lowest;
+        if (decade > highest) decade = highest;
+        match->resistance = best_r * pow(10.0, decade);
+        match->capacitance = best_c * pow(10.0, best_total - decade);
+    }
+    match->actual = 1.0 / (2.0 * PI * match->resistance * match->capacitance);
+    match->error = (match->actual - target) / target;
+}
+
+// Match every target cutoff; returns 0 if a target is not positive
+static int match_components_batch(const ESeries *series, const float *targets, int n, ComponentMatch *matches) {
+    for (int i = 0; i < n; i++) {
+        if (!(targets[i] > 0)) return 0;
+        match_components(series, targets[i], &matches[i]);
+    }
+    return 1;
+}
+
+// Print component matches as a table
+static void display_component_matches(const ComponentMatch *matches, int n) {
+    printf("  %12s %12s %12s %12s %9s\n", "Target (Hz)", "R (Ω)", "C (F)", "Actual (Hz)", "Error");
+    for (int i = 0; i < n; i++) {
+        printf("  %12.6g %12.6g %12.6g %12.6g %8.3f%%\n", matches[i].target, matches[i].resistance,
+               matches[i].capacitance, matches[i].actual, matches[i].error * 100.0);
+    }
+}
+
+// Display filter design results
+static void display_filter_results(FilterConfig *filter) {
     printf("\n");
-    if (!get_float("Enter amplitude: ", &wave.amplitude)) return;
-    if (!get_float("Enter frequency (Hz): ", &wave.frequency)) return;
-    if (!get_float("Enter sample rate (Hz): ", &wave.sample_rate)) return;
-    if (!get_int("Enter number of samples (10-200): ", &wave.count)) return;
+    print_header("FILTER DESIGN RESULTS");
     
-    if (wave.count < 10 || wave.count > 200) {
-        printf("Sample count must be between 10 and 200!\n");
-        return;
+    printf("  Type:           %s\n", filter->type);
+    printf("  Cutoff (-3dB):  %.2f Hz\n", filter->cutoff_freq);
+    printf("  Resistance:     %.2f Ω", filter->resistance);
+    if (filter->resistance > 1000) {
+        printf(" (%.2f kΩ)", filter->resistance / 1000.0f);
     }
+    printf("\n");
     
-    if (wave.amplitude <= 0 || wave.frequency <= 0 || wave.sample_rate <= 0) {
-        printf("All parameters must be positive!\n");
-        return;
+    printf("  Capacitance:    %.9f F\n", filter->capacitance);
+    if (filter->capacitance >= 1e-6) {
+        printf("                  %.2f µF\n", filter->capacitance * 1e6);
+    } else if (filter->capacitance >= 1e-9) {
+        printf("                  %.2f nF\n", filter->capacitance * 1e9);
+    } else {
+        printf("                  %.2f pF\n", filter->capacitance * 1e12);
     }
     
-    // Generate waveform
-    switch (type) {
-        case 1:
-            strcpy(wave.waveform_type, "Sine");
-            generate_sine(&wave);
-            break;
-        case 2:
-            strcpy(wave.waveform_type, "Square");
-            generate_square(&wave);
-            break;
-        case 3:
-            strcpy(wave.waveform_type, "Triangle");
-            generate_triangle(&wave);
-            break;
-        case 4:
-            strcpy(wave.waveform_type, "Noise");
-            generate_noise(&wave);
-            break;
+    float tau = filter->resistance * filter->capacitance;
+    printf("  Time Constant:  %.6f s", tau);
+    if (tau < 1e-3) {
+        printf(" (%.2f µs)", tau * 1e6);
+    } else if (tau < 1.0) {
+        printf(" (%.2f ms)", tau * 1e3);
     }
-    
-    // Display waveform
-    plot_waveform(&wave);
-    
-    // Save to file
-    char result_buf[256];
-    snprintf(result_buf, sizeof(result_buf), 
-        "Waveform Generated: %s, Freq=%.2f Hz, Amp=%.2f, Samples=%d", 
-        wave.waveform_type, wave.frequency, wave.amplitude, wave.count);
-    save_result(result_buf);
-}
\ No newline at end of file
+    printf("\n");
+    print_separator();
+}
+
+// WAVEFORM GENERATION FUNCTIONS (oscillators and noise are in elec.c)
+
+// Allocate sample storage for wave->count samples from the session arena.
+// Returns 0 if out of memory or over the --memory limit.
+static int alloc_waveform(Waveform *wave) {
+    wave->samples = elec_arena_alloc(&session_arena, wave->count);
+    return wave->samples != NULL;
+}
+
+// Hand the samples back to the arena for the next request
+static void free_waveform(Waveform *wave) {
+    elec_arena_release(&session_arena, wave->samples);
+    wave->samples = NULL;
+}
+
+// Same for a signal of signal->count samples
+static int alloc_signal(SignalData *signal) {
+    signal->values = elec_arena_alloc(&session_arena, signal->count);
+    return signal->values != NULL;
+}
+
+static void free_signal(SignalData *signal) {
+    elec_arena_release(&session_arena, signal->values);
+    signal->values = NULL;
+}
+
+// Generate sine wave 
+static void generate_sine(Waveform *wave) {
+    Oscillator osc;
+    elec_osc_init(&osc, wave->frequency, wave->sample_rate);
+    elec_osc_sine(&osc, wave->amplitude, wave->samples, wave->count);
+}
+
+// Generate square wave
+static void generate_square(Waveform *wave) {
+    Oscillator osc;
+    elec_osc_init(&osc, wave->frequency, wave->sample_rate);
+    elec_osc_square(&osc, wave->amplitude, wave->samples, wave->count);
+}
+
+// Generate triangle wave
+static void generate_triangle(Waveform *wave) {
+    Oscillator osc;
+    elec_osc_init(&osc, wave->frequency, wave->sample_rate);
+    elec_osc_triangle(&osc, wave->amplitude, wave->samples, wave->count);
+}
+
+// Generate noise
+static void generate_noise(Waveform *wave) {
+    if (!wave->has_seed) wave->seed = elec_random_seed();
+    elec_fill_noise(elec_noise_uniform, wave->seed, wave->amplitude, wave->samples, wave->count);
+}
+
+// Generate Gaussian noise (amplitude is the standard deviation)
+static void generate_gaussian(Waveform *wave) {
+    if (!wave->has_seed) wave->seed = elec_random_seed();
+    elec_fill_noise(elec_noise_gaussian, wave->seed, wave->amplitude, wave->samples, wave->count);
+}
+
+// Waveform types by menu number (1=Sine, 2=Square, 3=Triangle, 4=Noise,
+// 5=Gaussian noise): batch name and display name
+static const struct {
+    const char *name;
+    const char *label;
+} waveform_types[] = {
+    { "", "" }, { "sine", "Sine" }, { "square", "Square" }, { "triangle", "Triangle" }, { "noise", "Noise" },
+    { "gaussian", "Gaussian" }
+};
+
+// Menu number of a batch waveform name, 0 if there is none
+static int parse_waveform_type(const char *name) {
+    for (int type = 1; type <= 5; type++) {
+        if (strcmp(name, waveform_types[type].name) == 0) return type;
+    }
+    return 0;
+}
+
+// Generate a waveform by menu number
+static int generate_waveform(Waveform *wave, int type) {
+    switch (type) {
+        case 1: generate_sine(wave); break;
+        case 2: generate_square(wave); break;
+        case 3: generate_triangle(wave); break;
+        case 4: generate_noise(wave); break;
+        case 5: generate_gaussian(wave); break;
+        default: return 0;
+    }
+    strcpy(wave->waveform_type, waveform_types[type].label);
+    return 1;
+}
+
+// Cache key of a waveform of a type (as generate_waveform), with the
+// frequency and sample rate left out for noise, which does not use them.
+// Returns 0 for noise without an explicit seed, which is never cached.
+static int waveform_key(const Waveform *wave, int type, CacheKind kind, CacheKey *key) {
+    if (type >= 4 && !wave->has_seed) return 0;
+    memset(key, 0, sizeof(*key));
+    key->kind = kind;
+    key->type = (uint32_t)type;
+    key->count = wave->count;
+    key->params[0] = wave->amplitude;
+    if (type >= 4) {
+        key->seed = wave->seed;
+    } else {
+        key->params[1] = wave->frequency;
+        key->params[2] = wave->sample_rate;
+    }
+    return 1;
+}
+
+// Generate a waveform as generate_waveform, copying the samples of an
+// identical earlier request from the cache when there is one
+static int generate_waveform_cached(Waveform *wave, int type) {
+    CacheKey key;
+    if (type < 1 || type > 5 || !waveform_key(wave, type, CACHE_WAVEFORM, &key)) {
+        return generate_waveform(wave, type);
+    }
+    
+    size_t bytes = (size_t)wave->count * sizeof(float), size;
+    const void *samples = cache_get(&key, bytes, bytes, &size);
+    if (samples != NULL) {
+        memcpy(wave->samples, samples, bytes);
+        strcpy(wave->waveform_type, waveform_types[type].label);
+        return 1;
+    }
+    generate_waveform(wave, type);
+    cache_put(&key, wave->samples, bytes);
+    return 1;
+}
+
+// PLOT RENDERING
+//
+// A plot is drawn into one frame buffer and written with a single write().
+// Long series are decimated to one column per plot_width-th of the samples,
+// each column spanning the minimum to the maximum of its samples, so a spike
+// of a single sample still shows.
+
+static int plot_width = PLOT_WIDTH;      // columns (see set_plot_size)
+static int plot_height = PLOT_HEIGHT;    // rows
+
+static void set_plot_size(int width, int height) {
+    plot_width = width;
+    plot_height = height;
+}
+
+// Minimum and maximum of each column of a decimated series
+typedef struct {
+    const float *values;
+    long long count;
+    int columns;
+    float *lo;
+    float *hi;
+} PlotJob;
+
+static void plot_column(void *arg, long long c) {
+    PlotJob *job = arg;
+    long long first = c * job->count / job->columns;
+    long long end = (c + 1) * job->count / job->columns;
+    SignalStats st;
+    elec_compute_stats(job->values + first, end - first, &st);
+    job->lo[c] = st.min;
+    job->hi[c] = st.max;
+}
+
+// Draw columns spanning lo[c]..hi[c] into frame, which must hold
+// (columns + 2) * (height + 1) bytes. Returns the bytes used.
+static size_t render_plot(char *frame, const float *lo, const float *hi, int columns, int height) {
+    // Find min and max for scaling
+    float min_val = lo[0];
+    float max_val = hi[0];
+    for (int c = 1; c < columns; c++) {
+        if (lo[c] < min_val) min_val = lo[c];
+        if (hi[c] > max_val) max_val = hi[c];
+    }
+    
+    // Add margin
+    float margin = (max_val - min_val) * 0.1f;
+    min_val -= margin;
+    max_val += margin;
+    
+    float range = max_val - min_val;
+    if (range < 1e-6f) range = 1.0f;
+    float rows_per_unit = (height - 1) / range;
+    
+    // Blank rows with the centre line and the axis
+    size_t stride = (size_t)columns + 2;
+    for (int row = 0; row <= height; row++) {
+        char *line = frame + row * stride;
+        char fill = (row == height / 2) ? '-' : ' ';
+        if (row == height) fill = '-';
+        line[0] = (row == height) ? '+' : '|';
+        memset(line + 1, fill, (size_t)columns);
+        line[columns + 1] = '\n';
+    }
+    
+    // Each column from the row of its maximum down to the row of its minimum
+    for (int c = 0; c < columns; c++) {
+        float top_row = (max_val - hi[c]) * rows_per_unit + 0.5f;
+        float bottom_row = (max_val - lo[c]) * rows_per_unit + 0.5f;
+        if (!(top_row >= 0.0f)) top_row = 0.0f;             // also NaN
+        if (!(bottom_row < height)) bottom_row = height - 1;
+        int top = (int)top_row, bottom = (int)bottom_row;
+        for (int row = top; row <= bottom; row++) {
+            frame[row * stride + 1 + c] = '*';
+        }
+    }
+    return stride * (height + 1);
+}
+
+// Render a plot of the column ranges into a new frame for the caller to
+// free, setting len. Returns NULL if out of memory.
+static char *render_columns(const float *lo, const float *hi, int columns, size_t *len) {
+    char *frame = malloc(((size_t)columns + 2) * (plot_height + 1));
+    if (frame != NULL) *len = render_plot(frame, lo, hi, columns, plot_height);
+    return frame;
+}
+
+// Same for a series of values, decimated to plot_width columns
+static char *render_values(const float *values, long long count, size_t *len) {
+    if (count <= plot_width) return render_columns(values, values, (int)count, len);
+    
+    float lo[MAX_PLOT_WIDTH], hi[MAX_PLOT_WIDTH];
+    PlotJob job = { values, count, plot_width, lo, hi };
+    elec_parallel_for(plot_width, plot_column, &job);
+    return render_columns(lo, hi, plot_width, len);
+}
+
+// Write a rendered frame to stdout in one go
+static void write_frame(const char *frame, size_t len) {
+    if (frame == NULL) {
+        printf("Not enough memory to plot!\n");
+        return;
+    }
+    fflush(stdout);
+    write_all(STDOUT_FILENO, frame, len);
+}
+
+// ASCII plot of a series of values, decimated to plot_width columns
+static void plot_values(const float *values, long long count) {
+    size_t len;
+    char *frame = render_values(values, count, &len);
+    write_frame(frame, len);
+    free(frame);
+}
+
+// ASCII visualization of waveform. type is the waveform type the samples
+// were generated as (as generate_waveform), so that the rendered plot can
+// be cached, or 0 if they have been changed since.
+static void plot_waveform(Waveform *wave, int type) {
+    printf("\n");
+    print_header("WAVEFORM VISUALIZATION");
+    
+    CacheKey key;
+    const char *cached = NULL;
+    size_t len;
+    int cacheable = type > 0 && waveform_key(wave, type, CACHE_PLOT, &key);
+    if (cacheable) {
+        key.width = plot_width;
+        key.height = plot_height;
+        cached = cache_get(&key, 1, ((size_t)plot_width + 2) * (plot_height + 1), &len);
+    }
+    if (cached != NULL) {
+        write_frame(cached, len);
+    } else {
+        char *frame = render_values(wave->samples, wave->count, &len);
+        write_frame(frame, len);
+        if (frame != NULL && cacheable) cache_put(&key, frame, len);
+        free(frame);
+    }
+    
+    printf("\nWaveform: %s, Freq: %.2f Hz, Amp: %.2f, Samples: %d\n", 
+           wave->waveform_type, wave->frequency, wave->amplitude, wave->count);
+    print_separator();
+}
+
+// EXPORT FUNCTIONS
+//
+// Waveforms are written as WAV (16/24/32-bit PCM or 32-bit float, scaled so
+// that full_scale volts is digital full scale) or as raw float32 volts.
+// Samples are converted on the worker pool EXPORT_WINDOW at a time, either
+// into a buffer sent with writev() or, for large files, straight into a
+// mapping of the output. Raw float32 from memory is written with no copy.
+// A waveform with no sample buffer is generated window by window as it is
+// written, so exports can be far longer than memory allows.
+
+static long long export_mmap_min = EXPORT_MMAP_MIN;   // output size from which it is mapped
+
+static const struct {
+    const char *name;
+    int bytes;              // per sample
+} export_formats[] = {
+    { "", 0 }, { "pcm16", 2 }, { "pcm24", 3 }, { "pcm32", 4 }, { "float", 4 }, { "raw", 4 }
+};
+
+// Samples first..first+n-1 of a waveform type (as generate_waveform),
+// without generating the ones before. For Gaussian noise first must be even.
+static void waveform_block(const Waveform *wave, int type, float *out, long long first, long long n) {
+    Oscillator osc;
+    elec_osc_init(&osc, wave->frequency, wave->sample_rate);
+    elec_osc_advance(&osc, first);
+    switch (type) {
+        case 1: elec_osc_sine(&osc, wave->amplitude, out, n); break;
+        case 2: elec_osc_square(&osc, wave->amplitude, out, n); break;
+        case 3: elec_osc_triangle(&osc, wave->amplitude, out, n); break;
+        case 4: elec_noise_uniform(wave->seed, wave->amplitude, out, first, n); break;
+        default: elec_noise_gaussian(wave->seed, wave->amplitude, out, first, n); break;
+    }
+}
+
+// Round to integers of at most limit in magnitude, half away from zero.
+// The clamp is on the magnitude so the loop vectorizes.
+static inline void quantize(const float *restrict in, float scale, float limit, int32_t *restrict out, int n) {
+    for (int i = 0; i < n; i++) {
+        float v = in[i] * scale;
+        float m = fabsf(v) + 0.5f;
+        m = (m < limit) ? m : limit;
+        out[i] = (int32_t)copysignf(m, v);
+    }
+}
+
+// Convert n (at most STREAM_CHUNK_SAMPLES) samples to little-endian output;
+// scale maps volts to +-1. Full blocks have a constant trip count so the
+// loops vectorize.
+static inline void convert_samples(const float *restrict in, float scale, ExportFormat format,
+                            unsigned char *restrict out, int n) {
+    int32_t q[STREAM_CHUNK_SAMPLES];
+    
+    if (format == EXPORT_FLOAT) {
+        float *o = (float *)out;
+        for (int i = 0; i < n; i++) o[i] = in[i] * scale;
+    } else if (format == EXPORT_PCM16) {
+        quantize(in, scale * 32767.0f, 32767.0f, q, n);
+        int16_t *o = (int16_t *)out;
+        for (int i = 0; i < n; i++) o[i] = (int16_t)q[i];
+    } else if (format == EXPORT_PCM24) {
+        quantize(in, scale * 8388607.0f, 8388607.0f, q, n);
+        // Each 4-byte store's top byte is overwritten by the next sample
+        int i = 0;
+        for (; i + 1 < n; i++) memcpy(out + 3 * i, &q[i], 4);
+        if (i < n) memcpy(out + 3 * i, &q[i], 3);
+    } else if (format == EXPORT_PCM32) {
+        quantize(in, scale * 2147483647.0f, 2147483520.0f, (int32_t *)out, n);   // largest float below 2^31
+    } else {
+        memcpy(out, in, (size_t)n * sizeof(float));
+    }
+}
+
+// One window of an export being converted on the worker pool
+typedef struct {
+    const Waveform *wave;
+    int type;               // generator, when wave->samples is NULL
+    ExportFormat format;
+    float scale;
+    long long first;        // first sample of the window
+    long long count;
+    unsigned char *out;     // converted window
+} ExportJob;
+
+static void export_chunk(void *arg, long long chunk) {
+    ExportJob *job = arg;
+    int bytes = export_formats[job->format].bytes;
+    float buf[STREAM_CHUNK_SAMPLES];
+    long long first = chunk * EXPORT_CHUNK;
+    long long end = (first + EXPORT_CHUNK < job->count) ? first + EXPORT_CHUNK : job->count;
+    
+    for (long long i = first; i < end; i += STREAM_CHUNK_SAMPLES) {
+        int n = (end - i < STREAM_CHUNK_SAMPLES) ? (int)(end - i) : STREAM_CHUNK_SAMPLES;
+        const float *in = buf;
+        if (job->wave->samples != NULL) {
+            in = job->wave->samples + job->first + i;
+        } else {
+            waveform_block(job->wave, job->type, buf, job->first + i, n);
+        }
+        unsigned char *out = job->out + i * bytes;
+        if (n == STREAM_CHUNK_SAMPLES) {
+            convert_samples(in, job->scale, job->format, out, STREAM_CHUNK_SAMPLES);
+        } else {
+            convert_samples(in, job->scale, job->format, out, n);
+        }
+    }
+}
+
+// 44-byte WAV header for count mono samples
+static void wav_header(unsigned char *h, ExportFormat format, double sample_rate, long long count) {
+    uint32_t bytes = (uint32_t)export_formats[format].bytes;
+    uint32_t rate = (uint32_t)(sample_rate + 0.5);
+    uint32_t data_size = (uint32_t)(count * bytes);
+    uint32_t fields[] = { 36 + data_size, 16, rate, rate * bytes, data_size };
+    
+    memcpy(h, "RIFF", 4);
+    memcpy(h + 8, "WAVEfmt ", 8);
+    memcpy(h + 36, "data", 4);
+    memcpy(h + 4, &fields[0], 4);
+    memcpy(h + 16, &fields[1], 4);
+    uint16_t tag = (format == EXPORT_FLOAT) ? 3 : 1, channels = 1;
+    uint16_t align = (uint16_t)bytes, bits = (uint16_t)(8 * bytes);
+    memcpy(h + 20, &tag, 2);
+    memcpy(h + 22, &channels, 2);
+    memcpy(h + 24, &fields[2], 4);
+    memcpy(h + 28, &fields[3], 4);
+    memcpy(h + 32, &align, 2);
+    memcpy(h + 34, &bits, 2);
+    memcpy(h + 40, &fields[4], 4);
+}
+
+// writev() everything, resuming after partial writes
+static int writev_all(int fd, struct iovec *iov, int count) {
+    while (count > 0) {
+        ssize_t n = writev(fd, iov, count);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        while (count > 0 && (size_t)n >= iov->iov_len) {
+            n -= (ssize_t)iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (char *)iov->iov_base + n;
+            iov->iov_len -= (size_t)n;
+        }
+    }
+    return 1;
+}
+
+// Export wave->count samples of a waveform to path: from wave->samples if
+// set, otherwise generated as type while being written.
+// Returns NULL on success or an error message.
+static const char *export_waveform(const Waveform *wave, int type, ExportFormat format, float full_scale,
+                                   const char *path) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+    return "Exports can only be written on little-endian machines";
+#endif
+    long long count = wave->count;
+    int bytes = export_formats[format].bytes;
+    size_t header_size = (format == EXPORT_RAW) ? 0 : WAV_HEADER_SIZE;
+    long long total = (long long)header_size + count * bytes;
+    if (format != EXPORT_RAW && total - 8 > 0xFFFFFFFFLL) return "Too many samples for a WAV file (4 GiB)";
+    
+    unsigned char header[WAV_HEADER_SIZE];
+    if (header_size > 0) wav_header(header, format, wave->sample_rate, count);
+    
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);   // mapping needs read access
+    if (fd < 0) return "Cannot create output file";
+    
+    ExportJob job = { wave, type, format, (format == EXPORT_RAW) ? 1.0f : 1.0f / full_scale, 0, 0, NULL };
+    const char *error = NULL;
+    
+    if (format == EXPORT_RAW && wave->samples != NULL) {
+        // Straight from the sample buffer
+        struct iovec iov = { (void *)wave->samples, (size_t)count * sizeof(float) };
+        if (!writev_all(fd, &iov, 1)) error = "Write failed";
+    } else if (total >= export_mmap_min) {
+        // Reserve the whole file (so a full disk fails here, not as a fault
+        // while writing to the mapping), then convert into it window by window
+        long page = sysconf(_SC_PAGESIZE);
+        if (posix_fallocate(fd, 0, total) != 0) error = "Not enough disk space";
+        for (long long first = 0; error == NULL && first < count; first += EXPORT_WINDOW) {
+            job.first = first;
+            job.count = (count - first < EXPORT_WINDOW) ? count - first : EXPORT_WINDOW;
+            long long start = (long long)header_size + first * bytes;
+            long long offset = start / page * page;
+            size_t length = (size_t)(start - offset + job.count * bytes);
+            unsigned char *map = mmap(NULL, length, PROT_WRITE, MAP_SHARED, fd, offset);
+            if (map == MAP_FAILED) {
+                error = "Cannot map output file";
+                break;
+            }
+            if (first == 0) memcpy(map, header, header_size);
+            job.out = map + (start - offset);
+            elec_parallel_for((job.count + EXPORT_CHUNK - 1) / EXPORT_CHUNK, export_chunk, &job);
+            munmap(map, length);
+        }
+    } else {
+        // Convert into a buffer, the first write carrying the header
+        long long window = (count < EXPORT_WINDOW) ? count : EXPORT_WINDOW;
+        job.out = malloc((size_t)(window > 0 ? window : 1) * bytes);
+        if (job.out == NULL) error = "Not enough memory";
+        struct iovec iov[2] = { { header, header_size }, { NULL, 0 } };
+        int first_iov = (header_size > 0) ? 0 : 1;
+        if (count == 0 && error == NULL && header_size > 0 && !writev_all(fd, iov, 1)) error = "Write failed";
+        for (long long first = 0; error == NULL && first < count; first += EXPORT_WINDOW) {
+            job.first = first;
+            job.count = (count - first < EXPORT_WINDOW) ? count - first : EXPORT_WINDOW;
+            elec_parallel_for((job.count + EXPORT_CHUNK - 1) / EXPORT_CHUNK, export_chunk, &job);
+            iov[1].iov_base = job.out;
+            iov[1].iov_len = (size_t)(job.count * bytes);
+            if (!writev_all(fd, iov + first_iov, 2 - first_iov)) error = "Write failed";
+            first_iov = 1;
+        }
+        free(job.out);
+    }
+    
+    if (close(fd) != 0 && error == NULL) error = "Write failed";
+    return error;
+}
+
+// FREQUENCY RESPONSE FUNCTIONS (evaluated in elec.c)
+
+// Stream a whole sweep to out, SWEEP_WINDOW points at a time, as CSV rows
+// (frequency_hz,magnitude_db,phase_deg) or binary float32 triplets in the
+// same order. Returns 0 on a write error or if out of memory.
+static int write_response(const FrequencySweep *sweep, FILE *out, int binary) {
+    long long window = (sweep->points < SWEEP_WINDOW) ? sweep->points : SWEEP_WINDOW;
+    float *buf = malloc((size_t)window * 3 * sizeof(float));
+    if (buf == NULL) return 0;
+    float *frequency = buf, *magnitude = buf + window, *phase = buf + 2 * window;
+    
+    if (!binary) fprintf(out, "frequency_hz,magnitude_db,phase_deg\n");
+    for (long long first = 0; first < sweep->points; first += window) {
+        long long n = sweep->points - first;
+        if (n > window) n = window;
+        elec_evaluate_response(sweep, first, n, frequency, magnitude, phase);
+        
+        for (long long i = 0; i < n; i++) {
+            if (binary) {
+                float point[3] = { frequency[i], magnitude[i], phase[i] };
+                fwrite(point, sizeof(point), 1, out);
+            } else {
+                fprintf(out, "%.7g,%.5f,%.5f\n", frequency[i], magnitude[i], phase[i]);
+            }
+        }
+    }
+    
+    free(buf);
+    return fflush(out) == 0 && !ferror(out);
+}
+
+// ASCII Bode plot: magnitude and phase at plot_width log-spaced points
+static void plot_response(const FrequencySweep *sweep) {
+    FrequencySweep coarse;
+    FilterConfig filter = { .resistance = 1.0f };
+    filter.capacitance = (float)(1.0 / (2.0 * PI * sweep->cutoff_freq));
+    strcpy(filter.type, sweep->is_lowpass ? "Low-Pass" : "High-Pass");
+    int n = (sweep->points < plot_width) ? (int)sweep->points : plot_width;
+    elec_sweep_init(&coarse, &filter, sweep->start, sweep->stop, n);
+    
+    float frequency[MAX_PLOT_WIDTH], magnitude[MAX_PLOT_WIDTH], phase[MAX_PLOT_WIDTH];
+    elec_evaluate_response(&coarse, 0, n, frequency, magnitude, phase);
+    
+    printf("\n");
+    print_header("FREQUENCY RESPONSE (BODE PLOT)");
+    printf("  Magnitude: %.2f dB to %.2f dB\n", magnitude[0], magnitude[n - 1]);
+    plot_values(magnitude, n);
+    printf("\n  Phase: %.2f° to %.2f°\n", phase[0], phase[n - 1]);
+    plot_values(phase, n);
+    printf("\n%s, fc: %.2f Hz, log frequency axis %.4g Hz to %.4g Hz\n",
+           sweep->is_lowpass ? "Low-Pass" : "High-Pass", sweep->cutoff_freq, sweep->start, sweep->stop);
+    print_separator();
+}
+
+// TIME-DOMAIN FILTER FUNCTIONS (the filter bank is in elec.c)
+
+// Filter a waveform in place, chunk by chunk, collecting the statistics of
+// the signal before and after the filter. Returns 0 if out of memory.
+static int filter_waveform(const FilterConfig *filter, Waveform *wave, SignalStats *before, SignalStats *after) {
+    FilterBank bank;
+    if (!elec_filter_bank_init(&bank, 1)) return 0;
+    elec_filter_bank_set(&bank, 0, filter, wave->sample_rate);
+    
+    float buf[FILTER_CHUNK];
+    elec_stats_reset(before);
+    elec_stats_reset(after);
+    for (long long i = 0; i < wave->count; i += FILTER_CHUNK) {
+        long long n = (wave->count - i < FILTER_CHUNK) ? wave->count - i : FILTER_CHUNK;
+        elec_stats_update(before, wave->samples + i, n);
+        elec_filter_bank_run(&bank, wave->samples + i, buf, n);
+        elec_stats_update(after, buf, n);
+        memcpy(wave->samples + i, buf, (size_t)n * sizeof(float));
+    }
+    
+    elec_filter_bank_free(&bank);
+    return 1;
+}
+
+// Open a batch input: a text file ("-" for stdin) or a capture in the named
+// sample format, with scale and offset applied to capture samples. The
+// reader, capture and file are the caller's storage, released by
+// close_source(). Returns NULL on success or an error message.
+static const char *open_source(SampleSource *src, const char *path, const char *format, double scale,
+                               double offset, TextReader *reader, Capture *cap, FILE **in) {
+    src->reader = NULL;
+    src->capture = NULL;
+    src->next = 0;
+    
+    if (strcmp(format, "text") == 0) {
+        *in = (strcmp(path, "-") == 0) ? stdin : fopen(path, "r");
+        if (*in == NULL) return "cannot open file";
+        if (!text_reader_init(reader, *in)) {
+            if (*in != stdin) fclose(*in);
+            return "out of memory";
+        }
+        src->reader = reader;
+        return NULL;
+    }
+    
+    SampleFormat sample_format;
+    if (!parse_sample_format(format, &sample_format)) return "format must be text, f32, i16 or i32";
+    const char *error = open_capture(path, sample_format, scale, offset, cap);
+    if (error != NULL) return error;
+    src->capture = cap;
+    return NULL;
+}
+
+// Release an input opened by open_source()
+static void close_source(SampleSource *src, FILE *in) {
+    if (src->reader != NULL) {
+        text_reader_free(src->reader);
+        if (in != stdin) fclose(in);
+    } else {
+        close_capture((Capture *)src->capture);
+    }
+}
+
+// Read up to max samples, in volts. Returns the count (0 at the end), or -1
+// with the reader error set.
+static long long source_read(SampleSource *src, float *out, long long max) {
+    if (src->reader != NULL) return text_reader_read(src->reader, out, max);
+    
+    const Capture *cap = src->capture;
+    long long n = cap->count - src->next;
+    if (n > max) n = max;
+    double scale = cap->scale, offset = cap->offset;
+    
+    // Integer samples are scaled in double and rounded to float once
+    if (cap->format == SAMPLE_I16) {
+        const int16_t *raw = (const int16_t *)cap->data + src->next;
+        for (long long i = 0; i < n; i++) {
+            out[i] = (float)(scale * raw[i] + offset);
+        }
+    } else if (cap->format == SAMPLE_I32) {
+        const int32_t *raw = (const int32_t *)cap->data + src->next;
+        for (long long i = 0; i < n; i++) {
+            out[i] = (float)(scale * raw[i] + offset);
+        }
+    } else {
+        memcpy(out, (const float *)cap->data + src->next, (size_t)n * sizeof(float));
+        if (scale != 1.0 || offset != 0.0) {
+            for (long long i = 0; i < n; i++) {
+                out[i] = (float)(scale * out[i] + offset);
+            }
+        }
+    }
+    src->next += n;
+    return n;
+}
+
+// Read a whole source into a new buffer (at most MAX_WAVE_SAMPLES), for the
+// caller to free. Returns NULL on success or an error message.
+static const char *source_read_all(SampleSource *src, float **values, long long *count) {
+    long long capacity = (src->capture != NULL) ? src->capture->count : (1 << 16);
+    if (capacity > MAX_WAVE_SAMPLES) return "Too many samples";
+    if (capacity == 0) capacity = 1;
+    float *buf = malloc((size_t)capacity * sizeof(float));
+    long long n = 0, got;
+    
+    while (buf != NULL && (got = source_read(src, buf + n, capacity - n)) > 0) {
+        n += got;
+        if (n < capacity || src->capture != NULL) continue;
+        if (capacity == MAX_WAVE_SAMPLES) {
+            float extra;
+            if (source_read(src, &extra, 1) == 0) break;
+            free(buf);
+            return "Too many samples";
+        }
+        capacity = (capacity * 2 < MAX_WAVE_SAMPLES) ? capacity * 2 : MAX_WAVE_SAMPLES;
+        float *grown = realloc(buf, (size_t)capacity * sizeof(float));
+        if (grown == NULL) free(buf);
+        buf = grown;
+    }
+    if (buf == NULL) return "Not enough memory";
+    if (got < 0) {
+        free(buf);
+        return src->reader->error;
+    }
+    *values = buf;
+    *count = n;
+    return NULL;
+}
+
+// Filter a whole source through the bank, FILTER_CHUNK samples at a time,
+// collecting per-channel statistics before and after and optionally
+// writing the filtered frames as raw float32 to out.
+// Returns NULL on success or an error message.
+static const char *filter_source(FilterBank *bank, SampleSource *src, FILE *out,
+                                 SignalStats *before, SignalStats *after) {
+    int channels = bank->channels;
+    long long capacity = (FILTER_CHUNK / channels > 0) ? FILTER_CHUNK / channels * channels : channels;
+    float *in = malloc((size_t)capacity * 2 * sizeof(float));
+    if (in == NULL) return "Not enough memory";
+    float *filtered = in + capacity;
+    
+    for (int c = 0; c < channels; c++) {
+        elec_stats_reset(&before[c]);
+        elec_stats_reset(&after[c]);
+    }
+    
+    const char *error = NULL;
+    long long held = 0;   // samples of an incomplete frame kept from the last read
+    long long n;
+    while ((n = source_read(src, in + held, capacity - held)) > 0) {
+        n += held;
+        long long frames = n / channels;
+        held = n - frames * channels;
+        
+        elec_stats_update_interleaved(before, channels, in, frames);
+        elec_filter_bank_run(bank, in, filtered, frames);
+        elec_stats_update_interleaved(after, channels, filtered, frames);
+        if (out != NULL && fwrite(filtered, sizeof(float) * channels, (size_t)frames, out) != (size_t)frames) {
+            error = "Error writing output file";
+            break;
+        }
+        memmove(in, in + frames * channels, (size_t)held * sizeof(float));
+    }
+    if (n < 0) {
+        error = src->reader->error;
+    } else if (error == NULL && held != 0) {
+        error = "Sample count is not a multiple of the channel count";
+    }
+    
+    free(in);
+    return error;
+}
+
+// Per-channel statistics of interleaved frames from a source, in volts
+// (channels entries of st). A mapped capture is analysed in place on the
+// worker pool, integer ones exactly on their raw samples as in
+// analyze_capture; text is read in blocks of whole frames.
+// Returns NULL or an error message.
+static const char *analyze_channels(SampleSource *src, int channels, SignalStats *st) {
+    const Capture *cap = src->capture;
+    if (cap != NULL && cap->count % channels != 0) return "Sample count is not a multiple of the channel count";
+    if (cap != NULL && cap->format != SAMPLE_F32) {
+        IntStats *raw = malloc((size_t)channels * sizeof(IntStats));
+        int bits = (cap->format == SAMPLE_I16) ? 16 : 32;
+        if (raw == NULL || !elec_int_stats_interleaved_parallel(cap->data, bits, channels, cap->count / channels, raw)) {
+            free(raw);
+            return "Not enough memory";
+        }
+        for (int c = 0; c < channels; c++) {
+            elec_int_stats_volts(&raw[c], cap->scale, cap->offset, &st[c]);
+        }
+        free(raw);
+        return NULL;
+    }
+    if (cap != NULL) {
+        if (!elec_stats_interleaved_parallel(cap->data, channels, cap->count / channels, st)) return "Not enough memory";
+        if (cap->scale != 1.0 || cap->offset != 0.0) {
+            for (int c = 0; c < channels; c++) {
+                stats_scale(&st[c], cap->scale, cap->offset);
+            }
+        }
+        return NULL;
+    }
+    
+    long long capacity = (ELEC_ANALYSIS_CHUNK / channels > 0) ? ELEC_ANALYSIS_CHUNK / channels * channels : channels;
+    float *in = malloc((size_t)capacity * sizeof(float));
+    if (in == NULL) return "Not enough memory";
+    for (int c = 0; c < channels; c++) {
+        elec_stats_reset(&st[c]);
+    }
+    
+    const char *error = NULL;
+    long long held = 0;   // samples of an incomplete frame kept from the last read
+    long long n;
+    while ((n = source_read(src, in + held, capacity - held)) > 0) {
+        n += held;
+        long long frames = n / channels;
+        held = n - frames * channels;
+        elec_stats_update_interleaved(st, channels, in, frames);
+        memmove(in, in + frames * channels, (size_t)held * sizeof(float));
+    }
+    if (n < 0) {
+        error = src->reader->error;
+    } else if (held != 0) {
+        error = "Sample count is not a multiple of the channel count";
+    }
+    
+    free(in);
+    return error;
+}
+
+// STREAMING PIPELINE
+//
+// A generated signal is filtered, analysed and written out by four threads
+// at once, each stage handing blocks of PIPE_BLOCK samples to the next
+// through a single-producer/single-consumer ring. The blocks of a ring are
+// allocated once, from the session arena. The producer fills the block at
+// head and the consumer reads the one at tail; each index is written by
+// one side only, so handing over a block takes an atomic store and no
+// lock. A stage that finds its ring full (or empty) polls it for a while,
+// then sleeps until the other side moves on: a full ring holds back the
+// stages before it, so memory stays fixed however long the signal is.
+
+typedef struct {
+    float *blocks;                      // PIPE_SLOTS * PIPE_BLOCK samples
+    int counts[PIPE_SLOTS];             // samples in each block, 0 ends the stream
+    _Alignas(64) unsigned head;         // blocks published, written by the producer
+    int producer_sleeping;
+    long long producer_stalls;          // times the producer slept on a full ring
+    _Alignas(64) unsigned tail;         // blocks consumed, written by the consumer
+    int consumer_sleeping;
+    long long consumer_stalls;          // times the consumer slept on an empty ring
+} SampleRing;
+
+// Sleep while *index is seen, until ring_wake (or briefly without futexes)
+static void ring_sleep(unsigned *index, unsigned seen) {
+#ifdef __linux__
+    syscall(SYS_futex, index, FUTEX_WAIT_PRIVATE, seen, NULL, NULL, 0);
+#else
+    (void)index;
+    (void)seen;
+    struct timespec pause = { 0, 50000 };
+    nanosleep(&pause, NULL);
+#endif
+}
+
+static void ring_wake(unsigned *index) {
+#ifdef __linux__
+    syscall(SYS_futex, index, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+#else
+    (void)index;
+#endif
+}
+
+// Wait until the other side moves *index on from seen. Before sleeping,
+// *sleeping is set and the index checked again; the other side moves the
+// index and then checks *sleeping (both sequentially consistent), so one of
+// the two always sees the other and a wakeup cannot be lost.
+static void ring_wait(unsigned *index, unsigned seen, int *sleeping, long long *stalls) {
+    for (int polls = 0; __atomic_load_n(index, __ATOMIC_ACQUIRE) == seen; polls++) {
+        if (polls < PIPE_SPIN) {
+#if defined(__x86_64__) || defined(__i386__)
+            _mm_pause();
+#endif
+            continue;
+        }
+        __atomic_store_n(sleeping, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(index, __ATOMIC_SEQ_CST) == seen) {
+            (*stalls)++;
+            ring_sleep(index, seen);
+        }
+        __atomic_store_n(sleeping, 0, __ATOMIC_RELAXED);
+    }
+}
+
+// Producer: the next block to fill, waiting while the ring is full
+static float *ring_claim(SampleRing *ring) {
+    unsigned head = ring->head;
+    ring_wait(&ring->tail, head - PIPE_SLOTS, &ring->producer_sleeping, &ring->producer_stalls);
+    return ring->blocks + (size_t)(head % PIPE_SLOTS) * PIPE_BLOCK;
+}
+
+// Producer: hand over the claimed block holding count samples (0 to end the stream)
+static void ring_publish(SampleRing *ring, int count) {
+    unsigned head = ring->head;
+    ring->counts[head % PIPE_SLOTS] = count;
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&ring->consumer_sleeping, __ATOMIC_SEQ_CST)) ring_wake(&ring->head);
+}
+
+// Consumer: the next block and its sample count (0 at the end of the
+// stream), waiting while the ring is empty
+static int ring_peek(SampleRing *ring, const float **block) {
+    unsigned tail = ring->tail;
+    ring_wait(&ring->head, tail, &ring->consumer_sleeping, &ring->consumer_stalls);
+    *block = ring->blocks + (size_t)(tail % PIPE_SLOTS) * PIPE_BLOCK;
+    return ring->counts[tail % PIPE_SLOTS];
+}
+
+// Consumer: give the block back to the producer
+static void ring_release(SampleRing *ring) {
+    __atomic_store_n(&ring->tail, ring->tail + 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&ring->producer_sleeping, __ATOMIC_SEQ_CST)) ring_wake(&ring->tail);
+}
+
+// One run of the pipeline: generator -> filter -> analyser -> sink
+typedef struct {
+    const Waveform *wave;       // parameters, seed and name of the signal
+    int type;                   // as generate_waveform
+    int out_fd;                 // filtered samples as raw float32, -1 for none
+    int log;                    // sink saves the results
+    FilterBank bank;
+    SampleRing generated;       // generator -> filter
+    SampleRing filtered;        // filter -> analyser
+    SampleRing output;          // analyser -> sink, used only with out_fd
+    SignalStats before;         // set by the filter at the end of the stream
+    SignalStats after;          // set by the analyser
+    const char *error;          // set by the sink only
+    int aborted;                // a stage could not start (atomic, set before the end of the stream)
+} Pipeline;
+
+// Generator. The oscillator carries on from block to block, and PIPE_BLOCK
+// is a whole number of oscillator blocks, so the samples are exactly those
+// of generate_waveform.
+static void *pipe_generate(void *arg) {
+    Pipeline *p = arg;
+    const Waveform *wave = p->wave;
+    Oscillator osc;
+    elec_osc_init(&osc, wave->frequency, wave->sample_rate);
+    
+    for (long long first = 0; first < wave->count; first += PIPE_BLOCK) {
+        int n = (wave->count - first < PIPE_BLOCK) ? (int)(wave->count - first) : PIPE_BLOCK;
+        float *out = ring_claim(&p->generated);
+        switch (p->type) {
+            case 1: elec_osc_sine(&osc, wave->amplitude, out, n); break;
+            case 2: elec_osc_square(&osc, wave->amplitude, out, n); break;
+            case 3: elec_osc_triangle(&osc, wave->amplitude, out, n); break;
+            case 4: elec_noise_uniform(wave->seed, wave->amplitude, out, first, n); break;
+            default: elec_noise_gaussian(wave->seed, wave->amplitude, out, first, n); break;
+        }
+        ring_publish(&p->generated, n);
+    }
+    ring_claim(&p->generated);
+    ring_publish(&p->generated, 0);
+    return NULL;
+}
+
+// Filter, also collecting the statistics of its input
+static void *pipe_filter(void *arg) {
+    Pipeline *p = arg;
+    SignalStats before;
+    elec_stats_reset(&before);
+    
+    const float *in;
+    int n;
+    while ((n = ring_peek(&p->generated, &in)) > 0) {
+        float *out = ring_claim(&p->filtered);
+        elec_stats_update(&before, in, n);
+        elec_filter_bank_run(&p->bank, in, out, n);
+        ring_release(&p->generated);
+        ring_publish(&p->filtered, n);
+    }
+    p->before = before;
+    ring_claim(&p->filtered);
+    ring_publish(&p->filtered, 0);
+    return NULL;
+}
+
+// Analyser: statistics of the filtered signal, passed on to be written
+static void *pipe_analyse(void *arg) {
+    Pipeline *p = arg;
+    SignalStats after;
+    elec_stats_reset(&after);
+    
+    const float *in;
+    int n;
+    while ((n = ring_peek(&p->filtered, &in)) > 0) {
+        elec_stats_update(&after, in, n);
+        if (p->out_fd >= 0) {
+            memcpy(ring_claim(&p->output), in, (size_t)n * sizeof(float));
+            ring_publish(&p->output, n);
+        }
+        ring_release(&p->filtered);
+    }
+    p->after = after;
+    ring_claim(&p->output);
+    ring_publish(&p->output, 0);
+    return NULL;
+}
+
+// Sink: write the filtered samples, then log the results once the stream ends
+static void *pipe_sink(void *arg) {
+    Pipeline *p = arg;
+    const float *in;
+    int n;
+    while ((n = ring_peek(&p->output, &in)) > 0) {
+        if (p->error == NULL && !write_all(p->out_fd, (const char *)in, (size_t)n * sizeof(float))) {
+            p->error = "Error writing output file";
+        }
+        ring_release(&p->output);
+    }
+    if (p->error == NULL && p->log && !__atomic_load_n(&p->aborted, __ATOMIC_SEQ_CST)) {
+        save_waveform_result(p->wave);
+        save_analysis_result(p->after.count, elec_calculate_rms(&p->after),
+                             elec_calculate_peak_to_peak(&p->after), elec_calculate_average(&p->after));
+    }
+    return NULL;
+}
+
+// Run the pipeline set up in p (wave, type, out_fd, log) through filter,
+// each stage on its own thread, leaving the statistics before and after
+// the filter in p. Returns NULL on success or an error message.
+static const char *run_pipeline(Pipeline *p, const FilterConfig *filter) {
+    static void *(*const stages[])(void *) = { pipe_sink, pipe_analyse, pipe_filter, pipe_generate };
+    SampleRing *inputs[] = { &p->output, &p->filtered, &p->generated };
+    
+    float *blocks = elec_arena_alloc(&session_arena, 3LL * PIPE_SLOTS * PIPE_BLOCK);
+    if (blocks == NULL || !elec_filter_bank_init(&p->bank, 1)) {
+        elec_arena_release(&session_arena, blocks);
+        return "Not enough memory";
+    }
+    elec_filter_bank_set(&p->bank, 0, filter, p->wave->sample_rate);
+    p->generated = (SampleRing){ .blocks = blocks };
+    p->filtered = (SampleRing){ .blocks = blocks + PIPE_SLOTS * PIPE_BLOCK };
+    p->output = (SampleRing){ .blocks = blocks + 2 * PIPE_SLOTS * PIPE_BLOCK };
+    p->error = NULL;
+    p->aborted = 0;
+    
+    // Consumers first. If a stage cannot be started, the last one running
+    // is sent the end of the stream instead. The sink may be running, so
+    // the failure is kept apart from p->error until it has been joined.
+    pthread_t threads[4];
+    int started = 0;
+    while (started < 4 && pthread_create(&threads[started], NULL, stages[started], p) == 0) {
+        started++;
+    }
+    if (started < 4) {
+        __atomic_store_n(&p->aborted, 1, __ATOMIC_SEQ_CST);
+        if (started > 0) {
+            ring_claim(inputs[started - 1]);
+            ring_publish(inputs[started - 1], 0);
+        }
+    }
+    while (started > 0) {
+        pthread_join(threads[--started], NULL);
+    }
+    
+    elec_filter_bank_free(&p->bank);
+    elec_arena_release(&session_arena, blocks);
+    return p->aborted ? "Cannot start the pipeline threads" : p->error;
+}
+
+// SPECTRAL ANALYSIS FUNCTIONS (FFT and spectrum are in elec.c)
+
+// Feed a whole sample source into a spectrum. Returns NULL on success or an
+// error message.
+static const char *spectrum_source(Spectrum *sp, SampleSource *src) {
+    float buf[FILTER_CHUNK];
+    long long n;
+    while ((n = source_read(src, buf, FILTER_CHUNK)) > 0) {
+        elec_spectrum_update(sp, buf, n);
+    }
+    if (n < 0) return src->reader->error;
+    if (!elec_spectrum_finish(sp)) return "Fewer than 16 samples";
+    return NULL;
+}
+
+// ASCII plot of the spectrum in dB relative to its peak, one column per
+// band of bins (the strongest bin of the band is shown)
+static void plot_spectrum(const Spectrum *sp) {
+    int bins = sp->size / 2 + 1;
+    int columns = (bins < plot_width) ? bins : plot_width;
+    double top = 0.0;
+    for (int k = 0; k < bins; k++) {
+        if (sp->power[k] > top) top = sp->power[k];
+    }
+    
+    float level[MAX_PLOT_WIDTH];
+    for (int c = 0; c < columns; c++) {
+        int lo = (int)((long long)c * bins / columns);
+        int hi = (int)((long long)(c + 1) * bins / columns);
+        double best = 0.0;
+        for (int k = lo; k < hi; k++) {
+            if (sp->power[k] > best) best = sp->power[k];
+        }
+        double db = (best > 0.0 && top > 0.0) ? 10.0 * log10(best / top) : -120.0;
+        level[c] = (float)((db < -120.0) ? -120.0 : db);
+    }
+    
+    printf("\n");
+    print_header("SPECTRUM (dB RELATIVE TO PEAK)");
+    plot_values(level, columns);
+    printf("\n0 Hz to %.2f Hz, %.4g Hz per bin\n", sp->sample_rate / 2, sp->sample_rate / sp->size);
+    print_separator();
+}
+
+// UNIT CONVERSION FUNCTIONS (conversions are in elec.c)
+
+// Every conversion by command name
+static const struct {
+    const char *name;
+    const char *label;
+    float (*convert)(float);
+    ConvertArray convert_array;
+} unit_conversions[] = {
+    { "dbm2mw", "dBm -> mW",    elec_dbm_to_mw,             elec_dbm_to_mw_array },
+    { "mw2dbm", "mW -> dBm",    elec_mw_to_dbm,             elec_mw_to_dbm_array },
+    { "hz2rad", "Hz -> rad/s",  elec_hz_to_rad_s,           elec_hz_to_rad_s_array },
+    { "rad2hz", "rad/s -> Hz",  elec_rad_s_to_hz,           elec_rad_s_to_hz_array },
+    { "c2f",    "°C -> °F",     elec_celsius_to_fahrenheit, elec_celsius_to_fahrenheit_array },
+    { "f2c",    "°F -> °C",     elec_fahrenheit_to_celsius, elec_fahrenheit_to_celsius_array },
+};
+
+#define UNIT_CONVERSIONS ((int)(sizeof(unit_conversions) / sizeof(unit_conversions[0])))
+
+// Convert column (from 1) of every row of columns values in a text stream,
+// writing one result per line. Returns the number of values converted, or
+// -1 with the reader error set (or -2 if out fails).
+static long long convert_stream(ConvertArray convert, TextReader *reader, int column, int columns, FILE *out) {
+    float in[STREAM_CHUNK_SAMPLES], picked[STREAM_CHUNK_SAMPLES], result[STREAM_CHUNK_SAMPLES];
+    long long index = 0, total = 0, n;
+    
+    while ((n = text_reader_read(reader, in, STREAM_CHUNK_SAMPLES)) > 0) {
+        int m = 0;
+        if (columns == 1) {
+            memcpy(picked, in, (size_t)n * sizeof(float));
+            m = (int)n;
+        } else {
+            for (long long i = 0; i < n; i++) {
+                if ((index + i) % columns == column - 1) picked[m++] = in[i];
+            }
+        }
+        index += n;
+        
+        convert(picked, result, m);
+        for (int i = 0; i < m; i++) {
+            fprintf(out, "%.7g\n", result[i]);
+        }
+        total += m;
+    }
+    if (n < 0) return -1;
+    if (index % columns != 0) {
+        reader->error = "Incomplete last row";
+        // Input ending with a newline has moved on to an empty line
+        reader->error_line = reader->line - (reader->line > 1 && reader->line_start == reader->len);
+        reader->error_column = 1;
+        return -1;
+    }
+    return (fflush(out) != 0 || ferror(out)) ? -2 : total;
+}
+
+// ==================== MENU ITEM IMPLEMENTATIONS ====================
+
+// Convert one column of a text file of values into another file
+static void convert_file(void) {
+    printf("\nSelect conversion:\n");
+    for (int i = 0; i < UNIT_CONVERSIONS; i++) {
+        printf("  %d. %s\n", i + 1, unit_conversions[i].label);
+    }
+    
+    int type;
+    if (!get_int("\nChoice: ", &type)) return;
+    if (type < 1 || type > UNIT_CONVERSIONS) {
+        printf("Invalid choice!\n");
+        return;
+    }
+    
+    int column, columns;
+    if (!get_int("Values per row: ", &columns)) return;
+    if (columns < 1) {
+        printf("Rows must hold at least 1 value!\n");
+        return;
+    }
+    column = 1;
+    if (columns > 1 && !get_int("Column to convert (from 1): ", &column)) return;
+    if (column < 1 || column > columns) {
+        printf("Column must be between 1 and %d!\n", columns);
+        return;
+    }
+    
+    char path[256], out_path[256];
+    if (!get_line("Enter input file name: ", path, sizeof(path))) return;
+    if (!get_line("Enter output file name: ", out_path, sizeof(out_path))) return;
+    
+    FILE *in = fopen(path, "r");
+    if (in == NULL) {
+        printf("Cannot open file '%s'!\n", path);
+        return;
+    }
+    FILE *out = fopen(out_path, "w");
+    if (out == NULL) {
+        printf("Cannot create file '%s'!\n", out_path);
+        fclose(in);
+        return;
+    }
+    
+    TextReader reader;
+    if (!text_reader_init(&reader, in)) {
+        printf("Not enough memory!\n");
+        fclose(out);
+        fclose(in);
+        return;
+    }
+    
+    double start = now_seconds();
+    long long count = convert_stream(unit_conversions[type - 1].convert_array, &reader, column, columns, out);
+    double elapsed = now_seconds() - start;
+    
+    if (fclose(out) != 0 && count >= 0) count = -2;
+    if (count == -1) {
+        printf("%s at line %lld, column %lld!\n", reader.error, reader.error_line, reader.error_column);
+    } else if (count == -2) {
+        printf("Cannot write file '%s'!\n", out_path);
+    } else {
+        printf("\n%lld values converted (%s) to %s (%.0f values/sec)\n", count,
+               unit_conversions[type - 1].label, out_path, elapsed > 0 ? count / elapsed : 0.0);
+    }
+    
+    text_reader_free(&reader);
+    fclose(in);
+}
+
+/* Menu Item 1: Unit Converter */
+void menu_item_1(void) {
+    print_header("ENGINEERING UNIT CONVERTER");
+    
+    printf("\nSelect conversion:\n");
+    printf("  1. dBm ↔ mW (Power)\n");
+    printf("  2. Hz ↔ rad/s (Frequency)\n");
+    printf("  3. °C ↔ °F (Temperature)\n");
+    printf("  4. Convert a file of values\n");
+    
+    int type;
+    if (!get_int("\nChoice: ", &type)) return;
+    
+    int direction;
+    float input, result;
+    
+    switch (type) {
+        case 1: // Power
+            printf("\n1=dBm→mW, 2=mW→dBm: ");
+            if (!get_int("", &direction)) return;
+            
+            if (direction == 1) {
+                if (!get_float("Enter power (dBm): ", &input)) return;
+                result = elec_dbm_to_mw(input);
+                printf("\n%.2f dBm = %.6f mW = %.6f W\n", input, result, result/1000.0f);
+            } 
+            else if (direction == 2) {
+                if (!get_float("Enter power (mW): ", &input)) return;
+                result = elec_mw_to_dbm(input);
+                printf("\n%.6f mW = %.2f dBm\n", input, result);
+            }
+            else {
+                printf("Invalid direction!\n");
+                return;
+            }
+            break;
+            
+        case 2: // Frequency
+            printf("\n1=Hz→rad/s, 2=rad/s→Hz: ");
+            if (!get_int("", &direction)) return;
+            
+            if (direction == 1) {
+                if (!get_float("Enter frequency (Hz): ", &input)) return;
+                result = elec_hz_to_rad_s(input);
+                printf("\n%.2f Hz = %.4f rad/s\n", input, result);
+            } else if (direction == 2) {
+                if (!get_float("Enter angular frequency (rad/s): ", &input)) return;
+                result = elec_rad_s_to_hz(input);
+                printf("\n%.4f rad/s = %.2f Hz\n", input, result);
+            }
+            else {
+                printf("Invalid direction!\n");
+                return;
+            }
+            break;
+            
+        case 3: // Temperature
+            printf("\n1=°C→°F, 2=°F→°C: ");
+            if (!get_int("", &direction)) return;
+            
+            if (direction == 1) {
+                if (!get_float("Enter temperature (°C): ", &input)) return;
+                result = elec_celsius_to_fahrenheit(input);
+                printf("\n%.2f°C = %.2f°F\n", input, result);
+            } else if (direction == 2) {
+                if (!get_float("Enter temperature (°F): ", &input)) return;
+                result = elec_fahrenheit_to_celsius(input);
+                printf("\n%.2f°F = %.2f°C\n", input, result);
+            }
+            else {
+                printf("Invalid direction!\n");
+                return;
+            }
+            break;
+            
+        case 4:
+            convert_file();
+            break;
+            
+        default:
+            printf("Invalid choice!\n");
+    }
+}
+
+// Find standard component pairs for a few typed target cutoffs
+static void select_standard_parts(void) {
+    int number;
+    if (!get_int("\nE-series (12, 24 or 96): ", &number)) return;
+    
+    char name[8];
+    snprintf(name, sizeof(name), "E%d", number);
+    const ESeries *series = find_e_series(name);
+    if (series == NULL) {
+        printf("Invalid series!\n");
+        return;
+    }
+    
+    int count;
+    if (!get_int("Number of target cutoffs (1-20): ", &count)) return;
+    if (count < 1 || count > 20) {
+        printf("Invalid count!\n");
+        return;
+    }
+    
+    float targets[20];
+    for (int i = 0; i < count; i++) {
+        char prompt[64];
+        snprintf(prompt, sizeof(prompt), "  fc[%d] (Hz): ", i);
+        if (!get_float(prompt, &targets[i])) return;
+    }
+    
+    ComponentMatch matches[20];
+    if (!match_components_batch(series, targets, count, matches)) {
+        printf("Frequency must be positive!\n");
+        return;
+    }
+    
+    printf("\n");
+    print_header("STANDARD COMPONENT SELECTION");
+    printf("  Series: %s\n\n", series->name);
+    display_component_matches(matches, count);
+    print_separator();
+}
+
+// Design a filter, then plot its response and optionally save the full sweep
+static void filter_response(void) {
+    int type;
+    if (!get_int("\nFilter type (1 = Low-Pass, 2 = High-Pass): ", &type)) return;
+    if (type != 1 && type != 2) {
+        printf("Invalid choice!\n");
+        return;
+    }
+    
+    FilterConfig filter;
+    if (!design_filter(&filter, type == 1)) return;
+    display_filter_results(&filter);
+    
+    float start, stop;
+    int points;
+    if (!get_float("\nStart frequency (Hz): ", &start)) return;
+    if (!get_float("Stop frequency (Hz): ", &stop)) return;
+    if (!get_int("Number of points (up to 100000000): ", &points)) return;
+    
+    FrequencySweep sweep;
+    if (!elec_sweep_init(&sweep, &filter, start, stop, points)) {
+        printf("Frequencies must be positive, stop >= start, and 1 to 100000000 points!\n");
+        return;
+    }
+    plot_response(&sweep);
+    
+    char path[256];
+    if (!get_line("\nCSV file for all points (blank to skip): ", path, sizeof(path)) || path[0] == '\0') return;
+    
+    FILE *out = fopen(path, "w");
+    if (out == NULL) {
+        printf("Cannot open file!\n");
+        return;
+    }
+    double start_time = now_seconds();
+    int ok = write_response(&sweep, out, 0);
+    double elapsed = now_seconds() - start_time;
+    if (fclose(out) != 0) ok = 0;
+    
+    if (!ok) {
+        printf("Error writing file!\n");
+        return;
+    }
+    printf("Wrote %lld points in %.3f s (%.0f points/sec)\n", sweep.points, elapsed,
+           elapsed > 0 ? sweep.points / elapsed : 0.0);
+}
+
+static void filter_signal(void);
+
+/* Menu Item 2: RC Filter Designer */
+void menu_item_2(void) {
+    print_header("RC FILTER DESIGNER");
+    
+    FilterConfig filter;
+    
+    printf("\nSelect filter type:\n");
+    printf("  1. Low-Pass Filter\n");
+    printf("  2. High-Pass Filter\n");
+    printf("  3. Standard parts (E12/E24/E96) for target cutoffs\n");
+    printf("  4. Frequency response (Bode plot)\n");
+    printf("  5. Waveform or capture through the filter\n");
+    
+    int choice;
+    if (!get_int("\nChoice: ", &choice)) return;
+    
+    int ok;
+    if (choice == 3) {
+        select_standard_parts();
+        return;
+    } else if (choice == 4) {
+        filter_response();
+        return;
+    } else if (choice == 5) {
+        filter_signal();
+        return;
+    } else if (choice == 1) {
+        ok = design_filter(&filter, 1);  // Low-pass
+    } else if (choice == 2) {
+        ok = design_filter(&filter, 0);  // High-pass
+    } else {
+        printf("Invalid choice!\n");
+        return;
+    }
+    if (!ok) return;
+    
+    display_filter_results(&filter);
+}
+
+// Show and log the results of a stream or capture analysis
+static void display_long_analysis(const char *title, const SignalStats *st, float sample_rate, double elapsed) {
+    float rms = elec_calculate_rms(st);
+    float pk_pk = elec_calculate_peak_to_peak(st);
+    float avg = elec_calculate_average(st);
+    
+    printf("\n");
+    print_header(title);
+    printf("  Samples:        %lld\n", st->count);
+    printf("  Sample Rate:    %.2f Hz\n", sample_rate);
+    printf("  Duration:       %.6f s\n", st->count / sample_rate);
+    printf("  RMS Value:      %.4f V\n", rms);
+    printf("  Peak-to-Peak:   %.4f V\n", pk_pk);
+    printf("  Average (DC):   %.4f V\n", avg);
+    printf("  Throughput:     %.0f samples/sec\n", elapsed > 0 ? st->count / elapsed : 0.0);
+    print_separator();
+    
+    save_analysis_result(st->count, rms, pk_pk, avg);
+}
+
+// Signal analysis over a streamed file, reporting throughput
+static void analyze_stream(float sample_rate) {
+    char path[256];
+    if (!get_line("Enter file name ('-' for stdin): ", path, sizeof(path))) return;
+    
+    FILE *in = stdin;
+    if (strcmp(path, "-") != 0) {
+        in = fopen(path, "r");
+        if (in == NULL) {
+            printf("Cannot open file '%s'!\n", path);
+            return;
+        }
+    }
+    
+    SignalStats st;
+    TextReader reader;
+    double start = now_seconds();
+    int ok = stream_signal(in, &st, &reader);
+    double elapsed = now_seconds() - start;
+    
+    if (in != stdin) fclose(in);
+    if (!ok) {
+        printf("%s at line %lld, column %lld!\n", reader.error, reader.error_line, reader.error_column);
+        printf("Aborting.\n");
+        return;
+    }
+    if (st.count == 0) {
+        printf("No samples found!\n");
+        return;
+    }
+    
+    display_long_analysis("STREAM ANALYSIS RESULTS", &st, sample_rate, elapsed);
+}
+
+// Sliding-window statistics of a text stream, reported as it is read
+static void monitor_file(void) {
+    int window, decimation;
+    if (!get_int("Window length (samples): ", &window)) return;
+    if (window < 1 || window > ELEC_MAX_SLIDING_WINDOW) {
+        printf("Window must be between 1 and %d samples!\n", ELEC_MAX_SLIDING_WINDOW);
+        return;
+    }
+    if (!get_int("Report every N samples: ", &decimation)) return;
+    if (decimation < 1) {
+        printf("N must be at least 1!\n");
+        return;
+    }
+    
+    char path[256];
+    if (!get_line("Enter file name or pipe ('-' for stdin): ", path, sizeof(path))) return;
+    
+    FILE *in = stdin;
+    if (strcmp(path, "-") != 0 && (in = fopen(path, "r")) == NULL) {
+        printf("Cannot open file '%s'!\n", path);
+        return;
+    }
+    
+    TextReader reader;
+    SlidingStats ss = { 0 };
+    if (!text_reader_init(&reader, in) || !elec_sliding_init(&ss, window)) {
+        printf("Not enough memory!\n");
+        text_reader_free(&reader);
+        if (in != stdin) fclose(in);
+        return;
+    }
+    // stdin has already been read through stdio by the menu
+    reader.live = (in != stdin);
+    
+    printf("\n%12s %12s %12s %12s\n", "Sample", "RMS (V)", "Average (V)", "Pk-Pk (V)");
+    double start = now_seconds();
+    int ok = monitor_stream(&reader, &ss, decimation, stdout, 0);
+    double elapsed = now_seconds() - start;
+    
+    if (!ok) {
+        printf("%s at line %lld, column %lld!\n", reader.error, reader.error_line, reader.error_column);
+    } else if (ss.count == 0) {
+        printf("No samples found!\n");
+    } else {
+        SignalStats st;
+        elec_sliding_stats(&ss, &st);
+        printf("\n%lld samples monitored (%.0f samples/sec)\n", ss.count, elapsed > 0 ? ss.count / elapsed : 0.0);
+        save_analysis_result(st.count, elec_calculate_rms(&st), elec_calculate_peak_to_peak(&st), elec_calculate_average(&st));
+    }
+    
+    elec_sliding_free(&ss);
+    text_reader_free(&reader);
+    if (in != stdin) fclose(in);
+}
+
+// Ask for a capture file, its format and scale, and open it.
+// Returns 0 (with a message shown) if it cannot be opened.
+static int read_capture(Capture *cap) {
+    char path[256];
+    if (!get_line("Enter capture file name: ", path, sizeof(path))) return 0;
+    
+    printf("\nSample format (ignored if the file has a header):\n");
+    printf("  1. float32\n");
+    printf("  2. int16\n");
+    printf("  3. int32\n");
+    
+    int format;
+    if (!get_int("\nChoice: ", &format)) return 0;
+    if (format < SAMPLE_F32 || format > SAMPLE_I32) {
+        printf("Invalid choice!\n");
+        return 0;
+    }
+    
+    float scale = 1.0f;
+    if (!get_float("Enter scale (V per unit, e.g. 1): ", &scale)) return 0;
+    
+    const char *error = open_capture(path, (SampleFormat)format, scale, 0.0, cap);
+    if (error != NULL) {
+        printf("%s!\n", error);
+        return 0;
+    }
+    return 1;
+}
+
+// Signal analysis over a memory-mapped binary capture
+static void analyze_capture_file(float sample_rate) {
+    Capture cap;
+    if (!read_capture(&cap)) return;
+    if (cap.has_header) sample_rate = (float)cap.sample_rate;
+    
+    SignalStats st;
+    double start = now_seconds();
+    int ok = analyze_capture(&cap, &st);
+    double elapsed = now_seconds() - start;
+    close_capture(&cap);
+    
+    if (!ok) {
+        printf("Not enough memory!\n");
+        return;
+    }
+    if (st.count == 0) {
+        printf("No samples found!\n");
+        return;
+    }
+    
+    display_long_analysis("CAPTURE ANALYSIS RESULTS", &st, sample_rate, elapsed);
+}
+
+// Per-channel analysis of an interleaved multi-channel capture
+static void analyze_channels_file(float sample_rate) {
+    Capture cap;
+    if (!read_capture(&cap)) return;
+    if (cap.has_header) sample_rate = (float)cap.sample_rate;
+    
+    int channels;
+    if (!get_int("Enter number of channels: ", &channels)) {
+        close_capture(&cap);
+        return;
+    }
+    if (channels < 1 || channels > MAX_CHANNELS) {
+        printf("Channels must be between 1 and %d!\n", MAX_CHANNELS);
+        close_capture(&cap);
+        return;
+    }
+    SignalStats *st = malloc((size_t)channels * sizeof(SignalStats));
+    if (st == NULL) {
+        printf("Not enough memory!\n");
+        close_capture(&cap);
+        return;
+    }
+    
+    SampleSource src = { NULL, &cap, 0 };
+    double start = now_seconds();
+    const char *error = analyze_channels(&src, channels, st);
+    double elapsed = now_seconds() - start;
+    close_capture(&cap);
+    
+    if (error != NULL) {
+        printf("%s!\n", error);
+    } else if (st[0].count == 0) {
+        printf("No samples found!\n");
+    } else {
+        printf("\n");
+        print_header("MULTI-CHANNEL ANALYSIS RESULTS");
+        printf("  Channels:       %d\n", channels);
+        printf("  Frames:         %lld\n", st[0].count);
+        printf("  Sample Rate:    %.2f Hz per channel\n", sample_rate);
+        printf("  Duration:       %.6f s\n", st[0].count / sample_rate);
+        printf("  Throughput:     %.0f samples/sec\n", elapsed > 0 ? st[0].count * channels / elapsed : 0.0);
+        printf("\n  %7s %14s %14s %14s\n", "Channel", "RMS (V)", "Peak-to-Peak", "Average (V)");
+        for (int c = 0; c < channels; c++) {
+            printf("  %7d %14.4f %14.4f %14.4f\n", c, elec_calculate_rms(&st[c]), elec_calculate_peak_to_peak(&st[c]),
+                   elec_calculate_average(&st[c]));
+            save_channel_result(c, &st[c]);
+        }
+        print_separator();
+    }
+    free(st);
+}
+
+static const char *window_names[] = { "", "Rectangular", "Hann", "Blackman" };
+
+// Show, plot and log the results of a spectral analysis
+static void display_spectrum(const Spectrum *sp, const SpectralResult *res, double elapsed) {
+    printf("\n");
+    print_header("SPECTRAL ANALYSIS RESULTS");
+    printf("  Samples:        %lld\n", sp->count);
+    printf("  FFT Size:       %d (%.4g Hz per bin)\n", sp->size, sp->sample_rate / sp->size);
+    printf("  Window:         %s, %lld segment(s) averaged\n", window_names[sp->window], sp->segments);
+    printf("  Dominant Freq:  %.4f Hz\n", res->frequency);
+    printf("  Amplitude:      %.4f V\n", res->amplitude);
+    printf("  THD:            %.4f %% (%d harmonics)\n", res->thd * 100.0, res->harmonics);
+    printf("  SNR:            %.2f dB\n", res->snr_db);
+    printf("  Throughput:     %.0f samples/sec\n", elapsed > 0 ? sp->count / elapsed : 0.0);
+    print_separator();
+    plot_spectrum(sp);
+    
+    save_spectrum_result(sp->count, window_names[sp->window], (float)res->frequency,
+                         (float)(res->thd * 100.0), (float)res->snr_db);
+}
+
+// Spectral analysis of a text file or binary capture
+static void analyze_spectrum_file(float sample_rate, int binary) {
+    int size;
+    if (!get_int("FFT size (power of 2, 16-16777216): ", &size)) return;
+    if (size < (1 << ELEC_FFT_MIN_LOG) || size > (1 << ELEC_FFT_MAX_LOG) || (size & (size - 1)) != 0) {
+        printf("FFT size must be a power of 2 from 16 to 16777216!\n");
+        return;
+    }
+    
+    printf("\nWindow:\n");
+    printf("  1. Rectangular\n");
+    printf("  2. Hann\n");
+    printf("  3. Blackman\n");
+    
+    int window;
+    if (!get_int("\nChoice: ", &window)) return;
+    if (window < WINDOW_RECTANGULAR || window > WINDOW_BLACKMAN) {
+        printf("Invalid choice!\n");
+        return;
+    }
+    
+    SampleSource src = { NULL, NULL, 0 };
+    TextReader reader;
+    Capture cap;
+    FILE *in = stdin;
+    if (binary) {
+        if (!read_capture(&cap)) return;
+        if (cap.has_header) sample_rate = (float)cap.sample_rate;
+        src.capture = &cap;
+    } else {
+        char path[256];
+        if (!get_line("Enter file name ('-' for stdin): ", path, sizeof(path))) return;
+        if (strcmp(path, "-") != 0 && (in = fopen(path, "r")) == NULL) {
+            printf("Cannot open file '%s'!\n", path);
+            return;
+        }
+        if (!text_reader_init(&reader, in)) {
+            printf("Not enough memory!\n");
+            if (in != stdin) fclose(in);
+            return;
+        }
+        src.reader = &reader;
+    }
+    
+    Spectrum sp;
+    if (!elec_spectrum_init(&sp, size, (WindowType)window, sample_rate)) {
+        printf("Not enough memory!\n");
+    } else {
+        double start = now_seconds();
+        const char *error = spectrum_source(&sp, &src);
+        SpectralResult res;
+        if (error == NULL && !elec_analyze_spectrum(&sp, &res)) error = "Not enough memory";
+        double elapsed = now_seconds() - start;
+        
+        if (error != NULL && src.reader != NULL && error == reader.error) {
+            printf("%s at line %lld, column %lld!\n", reader.error, reader.error_line, reader.error_column);
+        } else if (error != NULL) {
+            printf("%s!\n", error);
+        } else {
+            display_spectrum(&sp, &res, elapsed);
+        }
+        elec_spectrum_free(&sp);
+    }
+    
+    if (binary) {
+        close_capture(&cap);
+    } else {
+        text_reader_free(&reader);
+        if (in != stdin) fclose(in);
+    }
+}
+
+/* Menu Item 3: Signal Analysis */
+void menu_item_3(void) {
+    print_header("SIGNAL ANALYSIS");
+    
+    SignalData signal = { .values = NULL, .count = 0 };
+    
+    printf("\nAnalyze signal properties (RMS, Peak-to-Peak, Average)\n");
+    
+    if (!get_float("Enter sample rate (Hz): ", &signal.sample_rate)) return;
+    
+    printf("\nSelect input source:\n");
+    printf("  1. Enter values manually\n");
+    printf("  2. Stream from text file (unlimited samples)\n");
+    printf("  3. Binary capture file (float32/int16/int32)\n");
+    printf("  4. Spectrum (FFT) of a text file\n");
+    printf("  5. Spectrum (FFT) of a binary capture file\n");
+    printf("  6. Sliding-window monitor of a text stream\n");
+    printf("  7. Multi-channel (interleaved) binary capture file\n");
+    
+    int source;
+    if (!get_int("\nChoice: ", &source)) return;
+    
+    if (source == 2) {
+        analyze_stream(signal.sample_rate);
+        return;
+    } else if (source == 3) {
+        analyze_capture_file(signal.sample_rate);
+        return;
+    } else if (source == 4 || source == 5) {
+        analyze_spectrum_file(signal.sample_rate, source == 5);
+        return;
+    } else if (source == 6) {
+        monitor_file();
+        return;
+    } else if (source == 7) {
+        analyze_channels_file(signal.sample_rate);
+        return;
+    } else if (source != 1) {
+        printf("Invalid choice!\n");
+        return;
+    }
+    
+    if (!get_int("Enter number of samples: ", &signal.count)) return;
+    
+    if (signal.count <= 0 || signal.count > MAX_WAVE_SAMPLES) {
+        printf("Invalid sample count!\n");
+        return;
+    }
+    if (!alloc_signal(&signal)) {
+        printf("Not enough memory for %d samples!\n", signal.count);
+        return;
+    }
+    
+    printf("\nEnter %d voltage values:\n", signal.count);
+    for (int i = 0; i < signal.count; i++) {
+        char prompt[64];
+        snprintf(prompt, sizeof(prompt), "  V[%d]: ", i);
+        if (!get_float(prompt, &signal.values[i])) {
+            printf("Aborting.\n");
+            free_signal(&signal);
+            return;
+        }
+    }
+    
+    // Calculate and display results (one fused pass over the samples)
+    SignalStats st;
+    elec_compute_stats(signal.values, signal.count, &st);
+    float rms = elec_calculate_rms(&st);
+    float pk_pk = elec_calculate_peak_to_peak(&st);
+    float avg = elec_calculate_average(&st);
+    
+    printf("\n");
+    print_header("ANALYSIS RESULTS");
+    printf("  Samples:        %d\n", signal.count);
+    printf("  Sample Rate:    %.2f Hz\n", signal.sample_rate);
+    printf("  RMS Value:      %.4f V\n", rms);
+    printf("  Peak-to-Peak:   %.4f V\n", pk_pk);
+    printf("  Average (DC):   %.4f V\n", avg);
+    print_separator();
+
+    save_analysis_result(signal.count, rms, pk_pk, avg);
+    free_signal(&signal);
+}
+
+// Ask for a waveform type and its parameters, and generate it.
+// Returns the type (as generate_waveform), or 0 (with a message shown) if
+// the input is invalid.
+static int read_waveform(Waveform *wave) {
+    printf("\nSelect waveform type:\n");
+    printf("  1. Sine Wave\n");
+    printf("  2. Square Wave\n");
+    printf("  3. Triangle Wave\n");
+    printf("  4. Noise (uniform)\n");
+    printf("  5. Noise (Gaussian)\n");
+    
+    int type;
+    if (!get_int("\nChoice: ", &type)) return 0;
+    
+    if (type < 1 || type > 5) {
+        printf("Invalid choice!\n");
+        return 0;
+    }
+    
+    printf("\n");
+    if (!get_float("Enter amplitude: ", &wave->amplitude)) return 0;
+    if (!get_float("Enter frequency (Hz): ", &wave->frequency)) return 0;
+    if (!get_float("Enter sample rate (Hz): ", &wave->sample_rate)) return 0;
+    if (!get_int("Enter number of samples (10-100000000): ", &wave->count)) return 0;
+    
+    if (wave->count < 10 || wave->count > MAX_WAVE_SAMPLES) {
+        printf("Sample count must be between 10 and %d!\n", MAX_WAVE_SAMPLES);
+        return 0;
+    }
+    
+    if (wave->amplitude <= 0 || wave->frequency <= 0 || wave->sample_rate <= 0) {
+        printf("All parameters must be positive!\n");
+        return 0;
+    }
+    
+    wave->has_seed = 0;
+    if (type >= 4) {
+        int seed;
+        if (!get_int("Enter seed (0 = random): ", &seed)) return 0;
+        wave->seed = (uint64_t)seed;
+        wave->has_seed = (seed != 0);
+    }
+    
+    if (!alloc_waveform(wave)) {
+        printf("Not enough memory for %d samples!\n", wave->count);
+        return 0;
+    }
+    
+    // Generate waveform
+    generate_waveform_cached(wave, type);
+    return type;
+}
+
+// Optionally write the generated samples to a WAV or raw file
+static void export_waveform_file(const Waveform *wave) {
+    char path[256];
+    if (!get_line("\nExport samples to file (blank to skip): ", path, sizeof(path)) || path[0] == '\0') return;
+    
+    printf("\nExport format:\n");
+    printf("  1. WAV 16-bit PCM\n");
+    printf("  2. WAV 24-bit PCM\n");
+    printf("  3. WAV 32-bit PCM\n");
+    printf("  4. WAV 32-bit float\n");
+    printf("  5. Raw float32 (volts)\n");
+    
+    int format;
+    if (!get_int("\nChoice: ", &format)) return;
+    if (format < EXPORT_PCM16 || format > EXPORT_RAW) {
+        printf("Invalid choice!\n");
+        return;
+    }
+    
+    float full_scale = 1.0f;
+    if (format != EXPORT_RAW && !get_float("Full-scale level (V, e.g. 1): ", &full_scale)) return;
+    if (full_scale <= 0) {
+        printf("Full-scale level must be positive!\n");
+        return;
+    }
+    
+    double start = now_seconds();
+    const char *error = export_waveform(wave, 0, (ExportFormat)format, full_scale, path);
+    double elapsed = now_seconds() - start;
+    if (error != NULL) {
+        printf("%s!\n", error);
+        return;
+    }
+    printf("Wrote %d samples to '%s' (%.1f MB/s)\n", wave->count, path,
+           elapsed > 0 ? (double)wave->count * export_formats[format].bytes / elapsed / 1e6 : 0.0);
+}
+
+/* Menu Item 4: Waveform Generator */
+void menu_item_4(void) {
+    print_header("WAVEFORM GENERATOR");
+    
+    Waveform wave;
+    int type = read_waveform(&wave);
+    if (type == 0) return;
+    
+    // Display waveform
+    plot_waveform(&wave, type);
+    
+    // Save to file
+    save_waveform_result(&wave);
+    export_waveform_file(&wave);
+    free_waveform(&wave);
+}
+
+// Show the signal level before and after filtering, and log the output
+static void display_filter_effect(const SignalStats *before, const SignalStats *after, double elapsed) {
+    float rms_in = elec_calculate_rms(before);
+    float rms_out = elec_calculate_rms(after);
+    
+    printf("\n");
+    print_header("FILTER OUTPUT");
+    printf("  Samples:        %lld\n", after->count);
+    printf("  RMS In:         %.4f V\n", rms_in);
+    printf("  RMS Out:        %.4f V\n", rms_out);
+    if (rms_in > 0) {
+        printf("  Gain:           %.2f dB\n", 20.0 * log10(rms_out / rms_in));
+    }
+    printf("  Peak-to-Peak:   %.4f V\n", elec_calculate_peak_to_peak(after));
+    printf("  Average (DC):   %.4f V\n", elec_calculate_average(after));
+    printf("  Throughput:     %.0f samples/sec\n", elapsed > 0 ? after->count / elapsed : 0.0);
+    print_separator();
+    
+    save_analysis_result(after->count, rms_out, elec_calculate_peak_to_peak(after), elec_calculate_average(after));
+}
+
+// Filter a capture file, optionally saving the output as raw float32
+static void filter_capture_file(const FilterConfig *filter) {
+    printf("\n");
+    Capture cap;
+    if (!read_capture(&cap)) return;
+    
+    float sample_rate = (float)cap.sample_rate;
+    if (!cap.has_header && !get_float("Enter sample rate (Hz): ", &sample_rate)) {
+        close_capture(&cap);
+        return;
+    }
+    if (sample_rate <= 0) {
+        printf("Sample rate must be positive!\n");
+        close_capture(&cap);
+        return;
+    }
+    
+    char out_path[256];
+    FILE *out = NULL;
+    if (get_line("Output file for filtered float32 samples (blank to skip): ", out_path, sizeof(out_path)) &&
+        out_path[0] != '\0') {
+        out = fopen(out_path, "wb");
+        if (out == NULL) {
+            printf("Cannot open file '%s'!\n", out_path);
+            close_capture(&cap);
+            return;
+        }
+    }
+    
+    FilterBank bank;
+    if (!elec_filter_bank_init(&bank, 1)) {
+        printf("Not enough memory!\n");
+    } else {
+        elec_filter_bank_set(&bank, 0, filter, sample_rate);
+        SampleSource src = { NULL, &cap, 0 };
+        SignalStats before, after;
+        
+        double start = now_seconds();
+        const char *error = filter_source(&bank, &src, out, &before, &after);
+        double elapsed = now_seconds() - start;
+        
+        if (error != NULL) {
+            printf("%s!\n", error);
+        } else if (after.count == 0) {
+            printf("No samples found!\n");
+        } else {
+            display_filter_effect(&before, &after, elapsed);
+        }
+        elec_filter_bank_free(&bank);
+    }
+    
+    if (out != NULL && fclose(out) != 0) printf("Error writing file!\n");
+    close_capture(&cap);
+}
+
+// Waveform Through RC Filter: a generated waveform or capture through a
+// designed filter
+static void filter_signal(void) {
+    print_header("WAVEFORM THROUGH RC FILTER");
+    
+    int type;
+    if (!get_int("\nFilter type (1 = Low-Pass, 2 = High-Pass): ", &type)) return;
+    if (type != 1 && type != 2) {
+        printf("Invalid choice!\n");
+        return;
+    }
+    
+    FilterConfig filter;
+    if (!design_filter(&filter, type == 1)) return;
+    
+    printf("\nSelect input signal:\n");
+    printf("  1. Generated waveform\n");
+    printf("  2. Binary capture file (float32/int16/int32)\n");
+    
+    int source;
+    if (!get_int("\nChoice: ", &source)) return;
+    
+    if (source == 2) {
+        filter_capture_file(&filter);
+        return;
+    } else if (source != 1) {
+        printf("Invalid choice!\n");
+        return;
+    }
+    
+    Waveform wave;
+    if (!read_waveform(&wave)) return;
+    
+    SignalStats before, after;
+    double start = now_seconds();
+    int ok = filter_waveform(&filter, &wave, &before, &after);
+    double elapsed = now_seconds() - start;
+    
+    if (!ok) {
+        printf("Not enough memory!\n");
+    } else {
+        printf("\nOutput of the %s filter (fc = %.2f Hz):\n", filter.type, filter.cutoff_freq);
+        plot_waveform(&wave, 0);
+        display_filter_effect(&before, &after, elapsed);
+    }
+    free_waveform(&wave);
+}
+
+// ==================== BATCH MODE ====================
+//
+// Non-interactive access to the same cores as the menu: one job from the
+// command line, or one job per line of a job file. Results are printed as
+// bare numbers on stdout, errors go to stderr.
+
+#define BATCH_MAX_ARGS 256
+#define BATCH_LINE_SIZE 4096
+
+static int batch_line = 0;   // current job file line, 0 for argv jobs
+
+// Report a failed job and return the failure status
+static int batch_error(const char *cmd, const char *msg) {
+    if (batch_line > 0) {
+        fprintf(stderr, "line %d: ", batch_line);
+    }
+    fprintf(stderr, "%s: %s\n", cmd, msg);
+    return 1;
+}
+
+// Report a text input error with its position
+static int batch_text_error(const char *cmd, const TextReader *reader) {
+    char msg[128];
+    snprintf(msg, sizeof(msg), "%s at line %lld, column %lld", reader->error, reader->error_line, reader->error_column);
+    return batch_error(cmd, msg);
+}
+
+// Parse a column/columns argument such as 2/4
+static int parse_column(const char *text, int *column, int *columns) {
+    int used = 0;
+    if (sscanf(text, "%d/%d%n", column, columns, &used) != 2 || text[used] != '\0') return 0;
+    return *columns >= 1 && *column >= 1 && *column <= *columns;
+}
+
+// <conversion> <value>...
+// <conversion> @<file|-> [column/columns] : every value (or one column of
+// rows of values) of a text file, one result per line
+static int batch_convert(int conversion, int argc, char **argv) {
+    if (argc < 2) return batch_error(argv[0], "expected a value");
+    
+    if (argv[1][0] == '@') {
+        int column = 1, columns = 1;
+        if (argc > 3 || (argc == 3 && !parse_column(argv[2], &column, &columns))) {
+            return batch_error(argv[0], "usage: <conversion> @<file|-> [column/columns]");
+        }
+        const char *path = argv[1] + 1;
+        FILE *in = (strcmp(path, "-") == 0) ? stdin : fopen(path, "r");
+        if (in == NULL) return batch_error(argv[0], "cannot open file");
+        
+        TextReader reader;
+        int failed = 0;
+        if (!text_reader_init(&reader, in)) {
+            failed = batch_error(argv[0], "out of memory");
+        } else {
+            long long n = convert_stream(unit_conversions[conversion].convert_array, &reader, column, columns, stdout);
+            if (n == -1) failed = batch_text_error(argv[0], &reader);
+            if (n == -2) failed = batch_error(argv[0], "write failed");
+        }
+        text_reader_free(&reader);
+        if (in != stdin) fclose(in);
+        return failed;
+    }
+    
+    float (*convert)(float) = unit_conversions[conversion].convert;
+    for (int i = 1; i < argc; i++) {
+        float input;
+        if (!parse_float(argv[i], &input)) return batch_error(argv[0], "invalid number");
+        printf("%.7g\n", convert(input));
+    }
+    return 0;
+}
+
+// Design and print one filter: type cutoff R C tau. Single designs go
+// through the cache; the many of a list would only crowd it.
+static int batch_print_filter(const char *cmd, int is_lowpass, float cutoff_freq, int known, float value, int cached) {
+    FilterConfig filter;
+    int ok = cached ? solve_filter_cached(&filter, is_lowpass, cutoff_freq, known, value)
+                    : elec_solve_filter(&filter, is_lowpass, cutoff_freq, known, value);
+    if (!ok) {
+        return batch_error(cmd, "cutoff and component value must be positive");
+    }
+    
+    printf("%s %.7g %.7g %.7g %.7g\n", filter.type, filter.cutoff_freq,
+           filter.resistance, filter.capacitance, filter.resistance * filter.capacitance);
+    return 0;
+}
+
+// Design a filter for every cutoff listed in a text file ('-' for stdin)
+static int batch_filter_list(const char *cmd, const char *path, int is_lowpass, int known, float value) {
+    FILE *in = stdin;
+    if (strcmp(path, "-") != 0) {
+        in = fopen(path, "r");
+        if (in == NULL) return batch_error(cmd, "cannot open file");
+    }
+    
+    TextReader reader;
+    if (!text_reader_init(&reader, in)) {
+        if (in != stdin) fclose(in);
+        return batch_error(cmd, "out of memory");
+    }
+    
+    float cutoffs[STREAM_CHUNK_SAMPLES];
+    long long n;
+    int failed = 0;
+    while ((n = text_reader_read(&reader, cutoffs, STREAM_CHUNK_SAMPLES)) > 0) {
+        for (long long i = 0; i < n; i++) {
+            failed |= batch_print_filter(cmd, is_lowpass, cutoffs[i], known, value, 0);
+        }
+    }
+    if (n < 0) failed = batch_text_error(cmd, &reader);
+    
+    text_reader_free(&reader);
+    if (in != stdin) fclose(in);
+    return failed;
+}
+
+// Parse the lp|hp and r|c arguments of a filter job.
+// Returns NULL on success or an error message.
+static const char *parse_filter_kind(const char *type, const char *known_name, int *is_lowpass, int *known) {
+    if (strcmp(type, "lp") == 0) {
+        *is_lowpass = 1;
+    } else if (strcmp(type, "hp") == 0) {
+        *is_lowpass = 0;
+    } else {
+        return "filter type must be lp or hp";
+    }
+    
+    if (strcmp(known_name, "r") == 0) {
+        *known = 1;
+    } else if (strcmp(known_name, "c") == 0) {
+        *known = 2;
+    } else {
+        return "known component must be r or c";
+    }
+    return NULL;
+}
+
+// filter lp|hp <cutoff Hz|@file> r|c <value>
+static int batch_filter(int argc, char **argv) {
+    if (argc != 5) return batch_error(argv[0], "usage: filter lp|hp <cutoff|@file> r|c <value>");
+    
+    int is_lowpass, known;
+    const char *error = parse_filter_kind(argv[1], argv[3], &is_lowpass, &known);
+    if (error != NULL) return batch_error(argv[0], error);
+    
+    float cutoff_freq, value;
+    if (!parse_float(argv[4], &value)) return batch_error(argv[0], "invalid number");
+    
+    if (argv[2][0] == '@') {
+        return batch_filter_list(argv[0], argv[2] + 1, is_lowpass, known, value);
+    }
+    if (!parse_float(argv[2], &cutoff_freq)) return batch_error(argv[0], "invalid number");
+    
+    return batch_print_filter(argv[0], is_lowpass, cutoff_freq, known, value, 1);
+}
+
+// bode lp|hp <cutoff> r|c <value> <start> <stop> <points> [csv|bin|plot] [file|-]
+static int batch_bode(int argc, char **argv) {
+    if (argc < 8 || argc > 10) {
+        return batch_error(argv[0], "usage: bode lp|hp <cutoff> r|c <value> <start> <stop> <points> [csv|bin|plot] [file|-]");
+    }
+    
+    int is_lowpass, known;
+    const char *error = parse_filter_kind(argv[1], argv[3], &is_lowpass, &known);
+    if (error != NULL) return batch_error(argv[0], error);
+    
+    float cutoff_freq, value, start, stop;
+    int points;
+    if (!parse_float(argv[2], &cutoff_freq) || !parse_float(argv[4], &value) || !parse_float(argv[5], &start) ||
+        !parse_float(argv[6], &stop) || !parse_int(argv[7], &points)) {
+        return batch_error(argv[0], "invalid number");
+    }
+    
+    const char *mode = (argc >= 9) ? argv[8] : "csv";
+    if (strcmp(mode, "csv") != 0 && strcmp(mode, "bin") != 0 && strcmp(mode, "plot") != 0) {
+        return batch_error(argv[0], "output must be csv, bin or plot");
+    }
+    
+    FilterConfig filter;
+    if (!elec_solve_filter(&filter, is_lowpass, cutoff_freq, known, value)) {
+        return batch_error(argv[0], "cutoff and component value must be positive");
+    }
+    FrequencySweep sweep;
+    if (!elec_sweep_init(&sweep, &filter, start, stop, points)) {
+        return batch_error(argv[0], "frequencies must be positive, stop >= start, and 1 to 100000000 points");
+    }
+    if (strcmp(mode, "plot") == 0) {
+        plot_response(&sweep);
+        return 0;
+    }
+    
+    FILE *out = stdout;
+    if (argc == 10 && strcmp(argv[9], "-") != 0) {
+        out = fopen(argv[9], strcmp(mode, "bin") == 0 ? "wb" : "w");
+        if (out == NULL) return batch_error(argv[0], "cannot open file");
+    }
+    int ok = write_response(&sweep, out, strcmp(mode, "bin") == 0);
+    if (out != stdout && fclose(out) != 0) ok = 0;
+    
+    return ok ? 0 : batch_error(argv[0], "write failed");
+}
+
+// rcfilter lp|hp <cutoff> r|c <value> <rate> <file|-> [text|f32|i16|i32] [channels] [out.f32]
+// Every channel of interleaved input goes through the same filter; prints
+// channel count rms-in rms-out per channel.
+static int batch_rcfilter(int argc, char **argv) {
+    if (argc < 7 || argc > 10) {
+        return batch_error(argv[0], "usage: rcfilter lp|hp <cutoff> r|c <value> <rate> <file|-> [text|f32|i16|i32] [channels] [out.f32]");
+    }
+    
+    int is_lowpass, known;
+    const char *error = parse_filter_kind(argv[1], argv[3], &is_lowpass, &known);
+    if (error != NULL) return batch_error(argv[0], error);
+    
+    float cutoff_freq, value, sample_rate;
+    int channels = 1;
+    if (!parse_float(argv[2], &cutoff_freq) || !parse_float(argv[4], &value) || !parse_float(argv[5], &sample_rate) ||
+        (argc >= 9 && !parse_int(argv[8], &channels))) {
+        return batch_error(argv[0], "invalid number");
+    }
+    if (channels < 1 || channels > MAX_CHANNELS) return batch_error(argv[0], "channels must be between 1 and 1024");
+    
+    FilterConfig filter;
+    if (!elec_solve_filter(&filter, is_lowpass, cutoff_freq, known, value)) {
+        return batch_error(argv[0], "cutoff and component value must be positive");
+    }
+    
+    const char *format = (argc >= 8) ? argv[7] : "text";
+    
+    // Open the input
+    SampleSource src;
+    TextReader reader;
+    Capture cap;
+    FILE *in = NULL;
+    error = open_source(&src, argv[6], format, 1.0, 0.0, &reader, &cap, &in);
+    if (error != NULL) return batch_error(argv[0], error);
+    if (src.capture != NULL && cap.has_header) sample_rate = (float)cap.sample_rate;
+    
+    FILE *out = NULL;
+    FilterBank bank = { 0 };
+    SignalStats *stats = malloc((size_t)channels * 2 * sizeof(SignalStats));
+    int failed = 0;
+    if (!(sample_rate > 0)) {
+        failed = batch_error(argv[0], "sample rate must be positive");
+    } else if (argc == 10 && (out = fopen(argv[9], "wb")) == NULL) {
+        failed = batch_error(argv[0], "cannot open output file");
+    } else if (stats == NULL || !elec_filter_bank_init(&bank, channels)) {
+        failed = batch_error(argv[0], "out of memory");
+    } else {
+        for (int c = 0; c < channels; c++) {
+            elec_filter_bank_set(&bank, c, &filter, sample_rate);
+        }
+        SignalStats *before = stats, *after = stats + channels;
+        error = filter_source(&bank, &src, out, before, after);
+        if (error != NULL && src.reader != NULL && error == reader.error) {
+            failed = batch_text_error(argv[0], &reader);
+        } else if (error != NULL) {
+            failed = batch_error(argv[0], error);
+        } else {
+            for (int c = 0; c < channels; c++) {
+                printf("%d %lld %.7g %.7g\n", c, after[c].count, elec_calculate_rms(&before[c]), elec_calculate_rms(&after[c]));
+                if (channels > 1) {
+                    save_channel_result(c, &after[c]);
+                } else {
+                    save_analysis_result(after[c].count, elec_calculate_rms(&after[c]),
+                                         elec_calculate_peak_to_peak(&after[c]), elec_calculate_average(&after[c]));
+                }
+            }
+        }
+    }
+    if (out != NULL && fclose(out) != 0 && !failed) failed = batch_error(argv[0], "write failed");
+    
+    elec_filter_bank_free(&bank);
+    free(stats);
+    close_source(&src, in);
+    return failed;
+}
+
+// Window by batch name
+static int parse_window(const char *name, WindowType *window) {
+    if (strcmp(name, "rect") == 0) {
+        *window = WINDOW_RECTANGULAR;
+    } else if (strcmp(name, "hann") == 0) {
+        *window = WINDOW_HANN;
+    } else if (strcmp(name, "blackman") == 0) {
+        *window = WINDOW_BLACKMAN;
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+// Write the averaged one-sided power per bin in V^2 (the bins of a tone
+// sum to its mean square)
+static int write_spectrum_bins(const Spectrum *sp, const char *path) {
+    FILE *out = fopen(path, "w");
+    if (out == NULL) return 0;
+    
+    double bin_width = sp->sample_rate / sp->size;
+    double scale = 2.0 / ((double)sp->segments * sp->size * sp->window_power);
+    fprintf(out, "frequency_hz,power_v2\n");
+    for (int k = 0; k <= sp->size / 2; k++) {
+        double p = sp->power[k] * scale;
+        if (k == 0 || k == sp->size / 2) p *= 0.5;
+        fprintf(out, "%.9g,%.9g\n", k * bin_width, p);
+    }
+    return fclose(out) == 0;
+}
+
+// spectrum <file|-> <rate> [size] [rect|hann|blackman] [text|f32|i16|i32] [bins.csv]
+// Prints frequency amplitude thd-percent snr-db segments.
+static int batch_spectrum(int argc, char **argv) {
+    if (argc < 3 || argc > 7) {
+        return batch_error(argv[0], "usage: spectrum <file|-> <rate> [size] [rect|hann|blackman] [text|f32|i16|i32] [bins.csv]");
+    }
+    
+    float sample_rate;
+    int size = 4096;
+    if (!parse_float(argv[2], &sample_rate) || (argc >= 4 && !parse_int(argv[3], &size))) {
+        return batch_error(argv[0], "invalid number");
+    }
+    if (size < (1 << ELEC_FFT_MIN_LOG) || size > (1 << ELEC_FFT_MAX_LOG) || (size & (size - 1)) != 0) {
+        return batch_error(argv[0], "size must be a power of 2 from 16 to 16777216");
+    }
+    
+    WindowType window = WINDOW_HANN;
+    if (argc >= 5 && !parse_window(argv[4], &window)) return batch_error(argv[0], "window must be rect, hann or blackman");
+    
+    const char *format = (argc >= 6) ? argv[5] : "text";
+    
+    // Open the input
+    SampleSource src;
+    TextReader reader;
+    Capture cap;
+    FILE *in = NULL;
+    const char *error = open_source(&src, argv[1], format, 1.0, 0.0, &reader, &cap, &in);
+    if (error != NULL) return batch_error(argv[0], error);
+    if (src.capture != NULL && cap.has_header) sample_rate = (float)cap.sample_rate;
+    
+    Spectrum sp;
+    int failed = 0;
+    if (!(sample_rate > 0)) {
+        failed = batch_error(argv[0], "sample rate must be positive");
+    } else if (!elec_spectrum_init(&sp, size, window, sample_rate)) {
+        failed = batch_error(argv[0], "out of memory");
+    } else {
+        SpectralResult res;
+        error = spectrum_source(&sp, &src);
+        if (error == NULL && !elec_analyze_spectrum(&sp, &res)) error = "out of memory";
+        if (error != NULL && src.reader != NULL && error == reader.error) {
+            failed = batch_text_error(argv[0], &reader);
+        } else if (error != NULL) {
+            failed = batch_error(argv[0], error);
+        } else if (argc == 7 && !write_spectrum_bins(&sp, argv[6])) {
+            failed = batch_error(argv[0], "cannot write bins file");
+        } else {
+            printf("%.7g %.7g %.7g %.4f %lld\n", res.frequency, res.amplitude, res.thd * 100.0, res.snr_db, sp.segments);
+            save_spectrum_result(sp.count, window_names[sp.window], (float)res.frequency,
+                                 (float)(res.thd * 100.0), (float)res.snr_db);
+        }
+        elec_spectrum_free(&sp);
+    }
+    
+    close_source(&src, in);
+    return failed;
+}
+
+// Print component matches: target R C actual relative-error
+static void batch_print_matches(const ComponentMatch *matches, int n) {
+    for (int i = 0; i < n; i++) {
+        printf("%.7g %.7g %.7g %.7g %.6f\n", matches[i].target, matches[i].resistance,
+               matches[i].capacitance, matches[i].actual, matches[i].error);
+    }
+}
+
+// eseries E12|E24|E96 <cutoff|@file>...
+static int batch_eseries(int argc, char **argv) {
+    if (argc < 3) return batch_error(argv[0], "usage: eseries E12|E24|E96 <cutoff|@file>...");
+    
+    const ESeries *series = find_e_series(argv[1]);
+    if (series == NULL) return batch_error(argv[0], "series must be E12, E24 or E96");
+    
+    float targets[STREAM_CHUNK_SAMPLES];
+    ComponentMatch matches[STREAM_CHUNK_SAMPLES];
+    
+    for (int a = 2; a < argc; a++) {
+        if (argv[a][0] != '@') {
+            if (!parse_float(argv[a], &targets[0])) return batch_error(argv[0], "invalid number");
+            if (!match_components_batch(series, targets, 1, matches)) {
+                return batch_error(argv[0], "cutoff must be positive");
+            }
+            batch_print_matches(matches, 1);
+            continue;
+        }
+        
+        const char *path = argv[a] + 1;
+        FILE *in = (strcmp(path, "-") == 0) ? stdin : fopen(path, "r");
+        if (in == NULL) return batch_error(argv[0], "cannot open file");
+        
+        TextReader reader;
+        if (!text_reader_init(&reader, in)) {
+            if (in != stdin) fclose(in);
+            return batch_error(argv[0], "out of memory");
+        }
+        
+        long long n;
+        int failed = 0;
+        while ((n = text_reader_read(&reader, targets, STREAM_CHUNK_SAMPLES)) > 0) {
+            if (!match_components_batch(series, targets, (int)n, matches)) {
+                failed = batch_error(argv[0], "cutoff must be positive");
+                break;
+            }
+            batch_print_matches(matches, (int)n);
+        }
+        if (n < 0) failed = batch_text_error(argv[0], &reader);
+        
+        text_reader_free(&reader);
+        if (in != stdin) fclose(in);
+        if (failed) return failed;
+    }
+    return 0;
+}
+
+// Print and log one analysis result: count rms peak-to-peak average
+static void batch_print_stats(const SignalStats *st) {
+    float rms = elec_calculate_rms(st);
+    float pk_pk = elec_calculate_peak_to_peak(st);
+    float avg = elec_calculate_average(st);
+    
+    printf("%lld %.7g %.7g %.7g\n", st->count, rms, pk_pk, avg);
+    save_analysis_result(st->count, rms, pk_pk, avg);
+}
+
+// stats <v1> <v2> ...
+static int batch_stats(int argc, char **argv) {
+    if (argc < 2) return batch_error(argv[0], "expected sample values");
+    
+    SignalData signal = { .count = argc - 1 };
+    if (!alloc_signal(&signal)) return batch_error(argv[0], "out of memory");
+    for (int i = 0; i < signal.count; i++) {
+        if (!parse_float(argv[i + 1], &signal.values[i])) {
+            free_signal(&signal);
+            return batch_error(argv[0], "invalid number");
+        }
+    }
+    
+    SignalStats st;
+    elec_compute_stats(signal.values, signal.count, &st);
+    free_signal(&signal);
+    batch_print_stats(&st);
+    return 0;
+}
+
+// analyze <file|->
+static int batch_analyze(int argc, char **argv) {
+    if (argc != 2) return batch_error(argv[0], "usage: analyze <file|->");
+    
+    FILE *in = stdin;
+    if (strcmp(argv[1], "-") != 0) {
+        in = fopen(argv[1], "r");
+        if (in == NULL) return batch_error(argv[0], "cannot open file");
+    }
+    
+    SignalStats st;
+    TextReader reader;
+    int ok = stream_signal(in, &st, &reader);
+    if (in != stdin) fclose(in);
+    if (!ok) return batch_text_error(argv[0], &reader);
+    
+    batch_print_stats(&st);
+    return 0;
+}
+
+// plot <file|-> [text|f32|i16|i32] : ASCII plot of a whole signal
+static int batch_plot(int argc, char **argv) {
+    if (argc < 2 || argc > 3) return batch_error(argv[0], "usage: plot <file|-> [text|f32|i16|i32]");
+    
+    const char *format = (argc == 3) ? argv[2] : "text";
+    
+    // Open the input
+    SampleSource src;
+    TextReader reader;
+    Capture cap;
+    FILE *in = NULL;
+    const char *error = open_source(&src, argv[1], format, 1.0, 0.0, &reader, &cap, &in);
+    if (error != NULL) return batch_error(argv[0], error);
+    
+    float *values = NULL;
+    long long count = 0;
+    int failed = 0;
+    error = source_read_all(&src, &values, &count);
+    if (error != NULL && src.reader != NULL && error == reader.error) {
+        failed = batch_text_error(argv[0], &reader);
+    } else if (error != NULL) {
+        failed = batch_error(argv[0], error);
+    } else if (count == 0) {
+        failed = batch_error(argv[0], "no samples");
+    } else {
+        SignalStats st;
+        elec_compute_stats(values, count, &st);
+        plot_values(values, count);
+        printf("%lld samples, %.4g to %.4g, %lld per column\n", count, st.min, st.max,
+               (count + plot_width - 1) / plot_width);
+    }
+    
+    free(values);
+    close_source(&src, in);
+    return failed;
+}
+
+// monitor <window> <decimation> [file|-]
+// Prints sample-number rms average peak-to-peak every decimation samples.
+static int batch_monitor(int argc, char **argv) {
+    if (argc < 3 || argc > 4) return batch_error(argv[0], "usage: monitor <window> <decimation> [file|-]");
+    
+    int window, decimation;
+    if (!parse_int(argv[1], &window) || !parse_int(argv[2], &decimation)) return batch_error(argv[0], "invalid number");
+    if (window < 1 || window > ELEC_MAX_SLIDING_WINDOW || decimation < 1) {
+        return batch_error(argv[0], "window must be 1 to 16777216 and decimation at least 1");
+    }
+    
+    const char *path = (argc == 4) ? argv[3] : "-";
+    FILE *in = (strcmp(path, "-") == 0) ? stdin : fopen(path, "r");
+    if (in == NULL) return batch_error(argv[0], "cannot open file");
+    
+    TextReader reader;
+    SlidingStats ss = { 0 };
+    int failed = 0;
+    if (!text_reader_init(&reader, in) || !elec_sliding_init(&ss, window)) {
+        failed = batch_error(argv[0], "out of memory");
+    } else {
+        // In a job file read from stdin, stdin is already being read through stdio
+        reader.live = (in != stdin || batch_line == 0);
+        if (!monitor_stream(&reader, &ss, decimation, stdout, 1)) {
+            failed = batch_text_error(argv[0], &reader);
+        } else if (ss.count > 0) {
+            SignalStats st;
+            elec_sliding_stats(&ss, &st);
+            save_analysis_result(st.count, elec_calculate_rms(&st), elec_calculate_peak_to_peak(&st), elec_calculate_average(&st));
+        }
+    }
+    
+    elec_sliding_free(&ss);
+    text_reader_free(&reader);
+    if (in != stdin) fclose(in);
+    return failed;
+}
+
+// channels <file|-> <channels> [text|f32|i16|i32] [scale] [offset]
+// Statistics of each channel of interleaved frames; prints channel count
+// rms peak-to-peak average per channel and logs one record per channel.
+static int batch_channels(int argc, char **argv) {
+    if (argc < 3 || argc > 6) {
+        return batch_error(argv[0], "usage: channels <file|-> <channels> [text|f32|i16|i32] [scale] [offset]");
+    }
+    
+    int channels;
+    float scale = 1.0f, offset = 0.0f;
+    if (!parse_int(argv[2], &channels) || (argc >= 5 && !parse_float(argv[4], &scale)) ||
+        (argc == 6 && !parse_float(argv[5], &offset))) {
+        return batch_error(argv[0], "invalid number");
+    }
+    if (channels < 1 || channels > MAX_CHANNELS) return batch_error(argv[0], "channels must be between 1 and 1024");
+    
+    const char *format = (argc >= 4) ? argv[3] : "text";
+    
+    // Open the input
+    SampleSource src;
+    TextReader reader;
+    Capture cap;
+    FILE *in = NULL;
+    const char *error = open_source(&src, argv[1], format, scale, offset, &reader, &cap, &in);
+    if (error != NULL) return batch_error(argv[0], error);
+    
+    SignalStats *stats = malloc((size_t)channels * sizeof(SignalStats));
+    int failed = 0;
+    if (stats == NULL) {
+        failed = batch_error(argv[0], "out of memory");
+    } else {
+        error = analyze_channels(&src, channels, stats);
+        if (error != NULL && src.reader != NULL && error == reader.error) {
+            failed = batch_text_error(argv[0], &reader);
+        } else if (error != NULL) {
+            failed = batch_error(argv[0], error);
+        } else {
+            for (int c = 0; c < channels; c++) {
+                // Text values are scaled here; captures were scaled as they were read
+                if (src.reader != NULL && (scale != 1.0f || offset != 0.0f)) stats_scale(&stats[c], scale, offset);
+                printf("%d %lld %.7g %.7g %.7g\n", c, stats[c].count, elec_calculate_rms(&stats[c]),
+                       elec_calculate_peak_to_peak(&stats[c]), elec_calculate_average(&stats[c]));
+                save_channel_result(c, &stats[c]);
+            }
+        }
+    }
+    
+    free(stats);
+    close_source(&src, in);
+    return failed;
+}
+
+// capture <file> [f32|i16|i32] [scale] [offset]
+static int batch_capture(int argc, char **argv) {
+    if (argc < 2 || argc > 5) return batch_error(argv[0], "usage: capture <file> [f32|i16|i32] [scale] [offset]");
+    
+    SampleFormat format = SAMPLE_F32;
+    if (argc >= 3 && !parse_sample_format(argv[2], &format)) {
+        return batch_error(argv[0], "format must be f32, i16 or i32");
+    }
+    float scale = 1.0f, offset = 0.0f;
+    if ((argc >= 4 && !parse_float(argv[3], &scale)) || (argc == 5 && !parse_float(argv[4], &offset))) {
+        return batch_error(argv[0], "invalid number");
+    }
+    
+    Capture cap;
+    const char *error = open_capture(argv[1], format, scale, offset, &cap);
+    if (error != NULL) return batch_error(argv[0], error);
+    
+    SignalStats st;
+    int ok = analyze_capture(&cap, &st);
+    close_capture(&cap);
+    if (!ok) return batch_error(argv[0], "out of memory");
+    
+    batch_print_stats(&st);
+    return 0;
+}
+
+// generate sine|square|triangle|noise|gaussian <amplitude> <freq> <sample rate> <count> [seed]
+static int batch_generate(int argc, char **argv) {
+    if (argc != 6 && argc != 7) {
+        return batch_error(argv[0], "usage: generate <type> <amplitude> <freq> <rate> <count> [seed]");
+    }
+    
+    int type = parse_waveform_type(argv[1]);
+    if (type == 0) return batch_error(argv[0], "type must be sine, square, triangle, noise or gaussian");
+    
+    Waveform wave;
+    if (!parse_float(argv[2], &wave.amplitude) || !parse_float(argv[3], &wave.frequency) ||
+        !parse_float(argv[4], &wave.sample_rate) || !parse_int(argv[5], &wave.count)) {
+        return batch_error(argv[0], "invalid number");
+    }
+    
+    wave.has_seed = (argc == 7);
+    if (wave.has_seed) {
+        char *end;
+        wave.seed = strtoull(argv[6], &end, 0);
+        if (end == argv[6] || *end != '\0') return batch_error(argv[0], "invalid seed");
+    }
+    if (wave.count < 1 || wave.count > MAX_WAVE_SAMPLES) {
+        return batch_error(argv[0], "sample count must be between 1 and 100000000");
+    }
+    if (wave.amplitude <= 0 || wave.frequency <= 0 || wave.sample_rate <= 0) {
+        return batch_error(argv[0], "all parameters must be positive");
+    }
+    
+    if (!alloc_waveform(&wave)) return batch_error(argv[0], "out of memory");
+    
+    generate_waveform_cached(&wave, type);
+    for (int i = 0; i < wave.count; i++) {
+        printf("%.7g\n", wave.samples[i]);
+    }
+    save_waveform_result(&wave);
+    free_waveform(&wave);
+    return 0;
+}
+
+// export sine|square|triangle|noise|gaussian <amplitude> <freq> <rate> <count> <file>
+//        [pcm16|pcm24|pcm32|float|raw] [full-scale] [seed]
+// The samples are generated while being written, so count is not limited
+// by memory.
+static int batch_export(int argc, char **argv) {
+    if (argc < 7 || argc > 10) {
+        return batch_error(argv[0], "usage: export <type> <amplitude> <freq> <rate> <count> <file> "
+                                    "[pcm16|pcm24|pcm32|float|raw] [full-scale] [seed]");
+    }
+    
+    int type = parse_waveform_type(argv[1]);
+    if (type == 0) return batch_error(argv[0], "type must be sine, square, triangle, noise or gaussian");
+    
+    int format = EXPORT_PCM16;
+    if (argc >= 8) {
+        format = 0;
+        for (int i = EXPORT_PCM16; i <= EXPORT_RAW; i++) {
+            if (strcmp(argv[7], export_formats[i].name) == 0) format = i;
+        }
+        if (format == 0) return batch_error(argv[0], "format must be pcm16, pcm24, pcm32, float or raw");
+    }
+    
+    Waveform wave = { .samples = NULL };
+    float full_scale = 1.0f;
+    if (!parse_float(argv[2], &wave.amplitude) || !parse_float(argv[3], &wave.frequency) ||
+        !parse_float(argv[4], &wave.sample_rate) || !parse_int(argv[5], &wave.count) ||
+        (argc >= 9 && !parse_float(argv[8], &full_scale))) {
+        return batch_error(argv[0], "invalid number");
+    }
+    
+    wave.has_seed = (argc == 10);
+    if (wave.has_seed) {
+        char *end;
+        wave.seed = strtoull(argv[9], &end, 0);
+        if (end == argv[9] || *end != '\0') return batch_error(argv[0], "invalid seed");
+    } else {
+        wave.seed = elec_random_seed();
+    }
+    if (wave.count < 1 || wave.count > MAX_EXPORT_SAMPLES) {
+        return batch_error(argv[0], "sample count must be between 1 and 2000000000");
+    }
+    if (wave.amplitude <= 0 || wave.frequency <= 0 || wave.sample_rate <= 0 || full_scale <= 0) {
+        return batch_error(argv[0], "all parameters must be positive");
+    }
+    strcpy(wave.waveform_type, waveform_types[type].label);
+    
+    const char *error = export_waveform(&wave, type, (ExportFormat)format, full_scale, argv[6]);
+    if (error != NULL) return batch_error(argv[0], error);
+    
+    printf("%d %s\n", wave.count, export_formats[format].name);
+    save_waveform_result(&wave);
+    return 0;
+}
+
+// pipeline sine|square|triangle|noise|gaussian <amplitude> <freq> <rate> <count>
+//          lp|hp <cutoff> r|c <value> [out.f32|-] [seed]
+// Generation, filtering, analysis and logging run at the same time on their
+// own threads, so count is not limited by memory. Prints count rms-in
+// rms-out peak-to-peak average, the last three of the filtered signal.
+static int batch_pipeline(int argc, char **argv) {
+    if (argc < 10 || argc > 12) {
+        return batch_error(argv[0], "usage: pipeline <type> <amplitude> <freq> <rate> <count> "
+                                    "lp|hp <cutoff> r|c <value> [out.f32|-] [seed]");
+    }
+    
+    int type = parse_waveform_type(argv[1]);
+    if (type == 0) return batch_error(argv[0], "type must be sine, square, triangle, noise or gaussian");
+    
+    int is_lowpass, known;
+    const char *error = parse_filter_kind(argv[6], argv[8], &is_lowpass, &known);
+    if (error != NULL) return batch_error(argv[0], error);
+    
+    Waveform wave = { .samples = NULL };
+    float cutoff_freq, value;
+    if (!parse_float(argv[2], &wave.amplitude) || !parse_float(argv[3], &wave.frequency) ||
+        !parse_float(argv[4], &wave.sample_rate) || !parse_int(argv[5], &wave.count) ||
+        !parse_float(argv[7], &cutoff_freq) || !parse_float(argv[9], &value)) {
+        return batch_error(argv[0], "invalid number");
+    }
+    
+    wave.has_seed = (argc == 12);
+    if (wave.has_seed) {
+        char *end;
+        wave.seed = strtoull(argv[11], &end, 0);
+        if (end == argv[11] || *end != '\0') return batch_error(argv[0], "invalid seed");
+    } else {
+        wave.seed = elec_random_seed();
+    }
+    if (wave.count < 1 || wave.count > MAX_EXPORT_SAMPLES) {
+        return batch_error(argv[0], "sample count must be between 1 and 2000000000");
+    }
+    if (wave.amplitude <= 0 || wave.frequency <= 0 || wave.sample_rate <= 0) {
+        return batch_error(argv[0], "all parameters must be positive");
+    }
+    FilterConfig filter;
+    if (!elec_solve_filter(&filter, is_lowpass, cutoff_freq, known, value)) {
+        return batch_error(argv[0], "cutoff and component value must be positive");
+    }
+    strcpy(wave.waveform_type, waveform_types[type].label);
+    
+    Pipeline p = { .wave = &wave, .type = type, .out_fd = -1, .log = 1 };
+    if (argc >= 11 && strcmp(argv[10], "-") != 0) {
+        p.out_fd = open(argv[10], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (p.out_fd < 0) return batch_error(argv[0], "cannot open output file");
+    }
+    error = run_pipeline(&p, &filter);
+    if (p.out_fd >= 0 && close(p.out_fd) != 0 && error == NULL) error = "Error writing output file";
+    if (error != NULL) return batch_error(argv[0], error);
+    
+    printf("%lld %.7g %.7g %.7g %.7g\n", p.after.count, elec_calculate_rms(&p.before), elec_calculate_rms(&p.after),
+           elec_calculate_peak_to_peak(&p.after), elec_calculate_average(&p.after));
+    return 0;
+}
+
+// SERVER MODE
+//
+// `serve <socket>` answers any number of local clients over a Unix domain
+// socket, with no process start or prompts per request. A request is one
+// line in the batch syntax and gets one line back, "ok" and the results or
+// "error" and a message:
+//   dbm2mw|mw2dbm|hz2rad|rad2hz|c2f|f2c <value>...         ok <result>...
+//   filter lp|hp <cutoff> r|c <value>                       ok <type> <cutoff> <R> <C> <tau>
+//   stats <v1> <v2> ...                                     ok <count> <rms> <pk-pk> <average>
+//   generate <type> <amplitude> <freq> <rate> <count> [seed]  ok <sample>...
+//   latency                                                 ok <requests> <p50 us> <p99 us>
+// One thread runs an epoll loop that accepts connections, reads requests
+// and writes replies, and a small pool of worker threads computes them.
+// A connection has one request in flight: its next line is read once the
+// reply has been sent, so replies come back in order and a client that
+// stops reading is not sent more. Results are not logged to results.txt.
+
+#ifdef __linux__
+
+#define SERVER_LINE_MAX (1 << 16)         // longest request, newline included
+#define SERVER_MAX_SAMPLES (1 << 15)      // most samples a generate request returns
+#define SERVER_WORKERS 4                  // default worker threads
+#define SERVER_EVENTS 64                  // epoll events handled per wakeup
+#define SERVER_LATENCY_SAMPLES (1 << 16)  // latest request latencies kept for percentiles
+
+typedef enum { CONN_READING, CONN_BUSY, CONN_WRITING } ConnState;
+
+// One client. While CONN_BUSY it belongs to a worker, otherwise to the loop.
+typedef struct ServerConn {
+    int fd;
+    ConnState state;
+    int eof;                        // the client has finished sending
+    char *in;                       // SERVER_LINE_MAX bytes of received requests
+    size_t in_len;
+    size_t line_len;                // request being served, newline included
+    char *out;                      // its reply
+    size_t out_len;
+    size_t out_cap;
+    size_t out_sent;
+    double started;                 // when the request was read
+    struct ServerConn *next_job;    // in the work queue or the done list
+    struct ServerConn *prev;        // all connections
+    struct ServerConn *next;
+} ServerConn;
+
+typedef struct {
+    int listen_fd;
+    int epoll_fd;
+    int wake_fd;                    // eventfd: replies done, or stop
+    int signal_fd;                  // SIGINT/SIGTERM, -1 if not used
+    sigset_t old_mask;              // signal mask to restore when signal_fd is used
+    const char *path;
+    int stop;                       // set by server_stop
+    pthread_mutex_t lock;           // guards the queue, the done list and quit
+    pthread_cond_t work;
+    ServerConn *queue;
+    ServerConn *queue_tail;
+    ServerConn *done;
+    int quit;
+    pthread_t workers[ELEC_MAX_THREADS];
+    int worker_count;
+    ServerConn *conns;
+    ServerConn *closed;             // closed during this round of events, freed after it
+    long long connections;
+    long long requests;
+    double latencies[SERVER_LATENCY_SAMPLES];   // seconds, a ring of the latest
+} Server;
+
+// Make room for n more bytes of reply. Returns 0 if out of memory.
+static int reply_reserve(ServerConn *conn, size_t n) {
+    if (conn->out_len + n <= conn->out_cap) return 1;
+    size_t cap = (conn->out_cap > 0) ? conn->out_cap : 256;
+    while (cap < conn->out_len + n) cap *= 2;
+    char *out = realloc(conn->out, cap);
+    if (out == NULL) return 0;
+    conn->out = out;
+    conn->out_cap = cap;
+    return 1;
+}
+
+// Reply "ok [word] values..." or "error message"
+static void reply_values(ServerConn *conn, const char *word, const float *values, long long count) {
+    conn->out_len = 0;
+    if (!reply_reserve(conn, 32 + strlen(word) + (size_t)count * 16)) {
+        conn->out_len = (size_t)snprintf(conn->out, conn->out_cap, "error out of memory\n");
+        return;
+    }
+    conn->out_len += (size_t)sprintf(conn->out, (word[0] != '\0') ? "ok %s" : "ok", word);
+    for (long long i = 0; i < count; i++) {
+        conn->out_len += (size_t)sprintf(conn->out + conn->out_len, " %.7g", values[i]);
+    }
+    conn->out[conn->out_len++] = '\n';
+}
+
+static void reply_error(ServerConn *conn, const char *msg) {
+    conn->out_len = 0;
+    if (reply_reserve(conn, strlen(msg) + 8)) conn->out_len = (size_t)sprintf(conn->out, "error %s\n", msg);
+}
+
+// Compute one request into values (SERVER_LINE_MAX / 2 of them), with an
+// optional leading word. Returns NULL on success or an error message.
+static const char *server_compute(int argc, char **argv, float *values, long long *count, const char **word) {
+    *word = "";
+    
+    for (int i = 0; i < UNIT_CONVERSIONS; i++) {
+        if (strcmp(argv[0], unit_conversions[i].name) != 0) continue;
+        if (argc < 2) return "expected a value";
+        for (int k = 1; k < argc; k++) {
+            if (!parse_float(argv[k], &values[k - 1])) return "invalid number";
+            values[k - 1] = unit_conversions[i].convert(values[k - 1]);
+        }
+        *count = argc - 1;
+        return NULL;
+    }
+    
+    if (strcmp(argv[0], "filter") == 0) {
+        if (argc != 5) return "usage: filter lp|hp <cutoff> r|c <value>";
+        int is_lowpass, known;
+        const char *error = parse_filter_kind(argv[1], argv[3], &is_lowpass, &known);
+        if (error != NULL) return error;
+        float cutoff_freq, value;
+        if (!parse_float(argv[2], &cutoff_freq) || !parse_float(argv[4], &value)) return "invalid number";
+        FilterConfig filter;
+        if (!elec_solve_filter(&filter, is_lowpass, cutoff_freq, known, value)) {
+            return "cutoff and component value must be positive";
+        }
+        *word = is_lowpass ? "Low-Pass" : "High-Pass";
+        values[0] = filter.cutoff_freq;
+        values[1] = filter.resistance;
+        values[2] = filter.capacitance;
+        values[3] = filter.resistance * filter.capacitance;
+        *count = 4;
+        return NULL;
+    }
+    
+    if (strcmp(argv[0], "stats") == 0) {
+        if (argc < 2) return "expected sample values";
+        for (int k = 1; k < argc; k++) {
+            if (!parse_float(argv[k], &values[k - 1])) return "invalid number";
+        }
+        SignalStats st;
+        elec_compute_stats(values, argc - 1, &st);
+        values[0] = (float)st.count;
+        values[1] = elec_calculate_rms(&st);
+        values[2] = elec_calculate_peak_to_peak(&st);
+        values[3] = elec_calculate_average(&st);
+        *count = 4;
+        return NULL;
+    }
+    
+    if (strcmp(argv[0], "generate") == 0) {
+        if (argc != 6 && argc != 7) return "usage: generate <type> <amplitude> <freq> <rate> <count> [seed]";
+        int type = parse_waveform_type(argv[1]);
+        if (type == 0) return "type must be sine, square, triangle, noise or gaussian";
+        Waveform wave;
+        if (!parse_float(argv[2], &wave.amplitude) || !parse_float(argv[3], &wave.frequency) ||
+            !parse_float(argv[4], &wave.sample_rate) || !parse_int(argv[5], &wave.count)) {
+            return "invalid number";
+        }
+        wave.seed = elec_random_seed();
+        if (argc == 7) {
+            char *end;
+            wave.seed = strtoull(argv[6], &end, 0);
+            if (end == argv[6] || *end != '\0') return "invalid seed";
+        }
+        if (wave.count < 1 || wave.count > SERVER_MAX_SAMPLES) return "sample count must be between 1 and 32768";
+        if (wave.amplitude <= 0 || wave.frequency <= 0 || wave.sample_rate <= 0) {
+            return "all parameters must be positive";
+        }
+        waveform_block(&wave, type, values, 0, wave.count);
+        *count = wave.count;
+        return NULL;
+    }
+    
+    return "unknown command";
+}
+
+// Worker thread: compute queued requests until the server quits
+static void *server_worker(void *arg) {
+    Server *srv = arg;
+    char **args = malloc((SERVER_LINE_MAX / 2 + 1) * sizeof(char *));
+    float *values = malloc(SERVER_LINE_MAX / 2 * sizeof(float));
+    
+    for (;;) {
+        pthread_mutex_lock(&srv->lock);
+        while (!srv->quit && srv->queue == NULL) {
+            pthread_cond_wait(&srv->work, &srv->lock);
+        }
+        ServerConn *conn = srv->queue;
+        if (srv->quit) conn = NULL;
+        if (conn != NULL) {
+            srv->queue = conn->next_job;
+            if (srv->queue == NULL) srv->queue_tail = NULL;
+        }
+        pthread_mutex_unlock(&srv->lock);
+        if (conn == NULL) break;
+        
+        // Split the line into arguments (at most one per two bytes)
+        int argc = 0;
+        char *save, *tok = (args != NULL) ? strtok_r(conn->in, " \t\r", &save) : NULL;
+        for (; tok != NULL; tok = strtok_r(NULL, " \t\r", &save)) {
+            args[argc++] = tok;
+        }
+        long long count = 0;
+        const char *word = "";
+        const char *error;
+        if (args == NULL || values == NULL) {
+            error = "out of memory";
+        } else if (argc == 0) {
+            error = "empty request";
+        } else {
+            error = server_compute(argc, args, values, &count, &word);
+        }
+        if (error == NULL) {
+            reply_values(conn, word, values, count);
+        } else {
+            reply_error(conn, error);
+        }
+        
+        pthread_mutex_lock(&srv->lock);
+        conn->next_job = srv->done;
+        srv->done = conn;
+        pthread_mutex_unlock(&srv->lock);
+        uint64_t one = 1;
+        if (write(srv->wake_fd, &one, sizeof(one)) < 0) {
+            // the counter is already non-zero, so the loop will wake anyway
+        }
+    }
+    
+    free(args);
+    free(values);
+    return NULL;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Median and 99th percentile of the kept latencies, in seconds
+static void server_percentiles(const Server *srv, double *p50, double *p99) {
+    long long n = (srv->requests < SERVER_LATENCY_SAMPLES) ? srv->requests : SERVER_LATENCY_SAMPLES;
+    *p50 = *p99 = 0.0;
+    double *sorted = malloc((size_t)(n > 0 ? n : 1) * sizeof(double));
+    if (n == 0 || sorted == NULL) {
+        free(sorted);
+        return;
+    }
+    memcpy(sorted, srv->latencies, (size_t)n * sizeof(double));
+    qsort(sorted, (size_t)n, sizeof(double), compare_doubles);
+    *p50 = sorted[(n - 1) / 2];
+    *p99 = sorted[(n - 1) * 99 / 100];
+    free(sorted);
+}
+
+// Close a connection. It is freed by server_free_closed, as later events
+// of the same epoll_wait may still refer to it.
+static void server_close_conn(Server *srv, ServerConn *conn) {
+    close(conn->fd);
+    conn->fd = -1;
+    if (conn->prev != NULL) {
+        conn->prev->next = conn->next;
+    } else {
+        srv->conns = conn->next;
+    }
+    if (conn->next != NULL) conn->next->prev = conn->prev;
+    conn->next = srv->closed;
+    srv->closed = conn;
+}
+
+static void server_free_closed(Server *srv) {
+    while (srv->closed != NULL) {
+        ServerConn *conn = srv->closed;
+        srv->closed = conn->next;
+        free(conn->in);
+        free(conn->out);
+        free(conn);
+    }
+}
+
+// A request finished: count its latency and start sending the reply
+static void server_finish(Server *srv, ServerConn *conn) {
+    srv->latencies[srv->requests % SERVER_LATENCY_SAMPLES] = now_seconds() - conn->started;
+    srv->requests++;
+    conn->out_sent = 0;
+    conn->state = CONN_WRITING;
+}
+
+// Move a connection on as far as it can go without blocking: send the
+// reply, then take the next request line, reading more when there is none
+static void server_advance(Server *srv, ServerConn *conn) {
+    for (;;) {
+        if (conn->state == CONN_BUSY || conn->fd < 0) return;
+        
+        if (conn->state == CONN_WRITING) {
+            while (conn->out_sent < conn->out_len) {
+                ssize_t n = send(conn->fd, conn->out + conn->out_sent, conn->out_len - conn->out_sent, MSG_NOSIGNAL);
+                if (n < 0 && errno == EINTR) continue;
+                if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+                if (n < 0) {
+                    server_close_conn(srv, conn);
+                    return;
+                }
+                conn->out_sent += (size_t)n;
+            }
+            conn->in_len -= conn->line_len;
+            memmove(conn->in, conn->in + conn->line_len, conn->in_len);
+            conn->state = CONN_READING;
+        }
+        
+        char *newline = memchr(conn->in, '\n', conn->in_len);
+        if (newline != NULL) {
+            *newline = '\0';
+            conn->line_len = (size_t)(newline - conn->in) + 1;
+            conn->started = now_seconds();
+            
+            // The latency figures belong to the loop, so it answers that itself
+            char word[16];
+            if (sscanf(conn->in, "%15s", word) == 1 && strcmp(word, "latency") == 0) {
+                double p50, p99;
+                server_percentiles(srv, &p50, &p99);
+                float values[3] = { (float)srv->requests, (float)(p50 * 1e6), (float)(p99 * 1e6) };
+                reply_values(conn, "", values, 3);
+                server_finish(srv, conn);
+                continue;
+            }
+            
+            conn->state = CONN_BUSY;
+            conn->next_job = NULL;
+            pthread_mutex_lock(&srv->lock);
+            if (srv->queue_tail != NULL) {
+                srv->queue_tail->next_job = conn;
+            } else {
+                srv->queue = conn;
+            }
+            srv->queue_tail = conn;
+            pthread_cond_signal(&srv->work);
+            pthread_mutex_unlock(&srv->lock);
+            return;
+        }
+        
+        if (conn->eof || conn->in_len == SERVER_LINE_MAX) {   // done, or a line that is too long
+            server_close_conn(srv, conn);
+            return;
+        }
+        ssize_t n = recv(conn->fd, conn->in + conn->in_len, SERVER_LINE_MAX - conn->in_len, 0);
+        if (n > 0) {
+            conn->in_len += (size_t)n;
+        } else if (n == 0) {
+            conn->eof = 1;
+        } else if (errno != EINTR) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) server_close_conn(srv, conn);
+            return;
+        }
+    }
+}
+
+static void server_accept(Server *srv) {
+    for (;;) {
+        int fd = accept(srv->listen_fd, NULL, NULL);
+        if (fd < 0) return;   // no more pending (or out of descriptors: retried on the next event)
+        
+        ServerConn *conn = calloc(1, sizeof(ServerConn));
+        fcntl(fd, F_SETFL, O_NONBLOCK);
+        if (conn != NULL) conn->in = malloc(SERVER_LINE_MAX);
+        struct epoll_event ev = { .events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET, .data.ptr = conn };
+        if (conn == NULL || conn->in == NULL || epoll_ctl(srv->epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            if (conn != NULL) free(conn->in);
+            free(conn);
+            close(fd);
+            continue;
+        }
+        conn->fd = fd;
+        conn->next = srv->conns;
+        if (srv->conns != NULL) srv->conns->prev = conn;
+        srv->conns = conn;
+        srv->connections++;
+        server_advance(srv, conn);
+    }
+}
+
+// Send the replies the workers have finished
+static void server_collect(Server *srv) {
+    uint64_t count;
+    if (read(srv->wake_fd, &count, sizeof(count)) < 0) {
+        // nothing to clear
+    }
+    pthread_mutex_lock(&srv->lock);
+    ServerConn *done = srv->done;
+    srv->done = NULL;
+    pthread_mutex_unlock(&srv->lock);
+    
+    while (done != NULL) {
+        ServerConn *conn = done;
+        done = conn->next_job;
+        server_finish(srv, conn);
+        server_advance(srv, conn);
+    }
+}
+
+// Serve until server_stop or a SIGINT/SIGTERM (with signals set)
+static void server_run(Server *srv) {
+    struct epoll_event events[SERVER_EVENTS];
+    while (!__atomic_load_n(&srv->stop, __ATOMIC_ACQUIRE)) {
+        int n = epoll_wait(srv->epoll_fd, events, SERVER_EVENTS, -1);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) break;
+        
+        for (int i = 0; i < n; i++) {
+            void *tag = events[i].data.ptr;
+            if (tag == &srv->listen_fd) {
+                server_accept(srv);
+            } else if (tag == &srv->wake_fd) {
+                server_collect(srv);
+            } else if (tag == &srv->signal_fd) {
+                // Consume the signal, so it is not delivered once unblocked
+                struct signalfd_siginfo info;
+                while (read(srv->signal_fd, &info, sizeof(info)) == sizeof(info)) {
+                }
+                srv->stop = 1;
+            } else {
+                server_advance(srv, tag);
+            }
+        }
+        server_free_closed(srv);
+    }
+}
+
+// Stop the workers, drop every connection, remove the socket and restore
+// the signal mask
+static void server_close(Server *srv) {
+    pthread_mutex_lock(&srv->lock);
+    srv->quit = 1;
+    pthread_cond_broadcast(&srv->work);
+    pthread_mutex_unlock(&srv->lock);
+    for (int i = 0; i < srv->worker_count; i++) {
+        pthread_join(srv->workers[i], NULL);
+    }
+    
+    while (srv->conns != NULL) {
+        server_close_conn(srv, srv->conns);
+    }
+    server_free_closed(srv);
+    if (srv->listen_fd >= 0) {
+        close(srv->listen_fd);
+        unlink(srv->path);
+    }
+    if (srv->epoll_fd >= 0) close(srv->epoll_fd);
+    if (srv->wake_fd >= 0) close(srv->wake_fd);
+    if (srv->signal_fd >= 0) {
+        close(srv->signal_fd);
+        pthread_sigmask(SIG_SETMASK, &srv->old_mask, NULL);
+    }
+    pthread_mutex_destroy(&srv->lock);
+    pthread_cond_destroy(&srv->work);
+}
+
+// Listen on path with workers threads, optionally stopping on SIGINT or
+// SIGTERM (which are then blocked in every thread and read from a
+// signalfd). An old socket left at path is replaced. On failure everything
+// is closed again. Returns NULL on success or an error message.
+static const char *server_open(Server *srv, const char *path, int workers, int signals) {
+    srv->path = path;
+    srv->listen_fd = srv->epoll_fd = srv->wake_fd = srv->signal_fd = -1;
+    pthread_mutex_init(&srv->lock, NULL);
+    pthread_cond_init(&srv->work, NULL);
+    
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (strlen(path) >= sizeof(addr.sun_path)) return "socket path too long";
+    strcpy(addr.sun_path, path);
+    
+    struct stat st;
+    if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode)) unlink(path);
+    const char *error = NULL;
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        error = "cannot bind socket";
+    } else {
+        srv->listen_fd = fd;
+        if (listen(fd, SOMAXCONN) != 0) error = "cannot listen on socket";
+    }
+    if (fd >= 0 && srv->listen_fd < 0) close(fd);
+    
+    if (error == NULL) {
+        srv->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        srv->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (signals) {
+            sigset_t mask;
+            sigemptyset(&mask);
+            sigaddset(&mask, SIGINT);
+            sigaddset(&mask, SIGTERM);
+            pthread_sigmask(SIG_BLOCK, &mask, &srv->old_mask);
+            srv->signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+            if (srv->signal_fd < 0) pthread_sigmask(SIG_SETMASK, &srv->old_mask, NULL);
+        }
+        struct epoll_event ev = { .events = EPOLLIN };
+        int ok = srv->epoll_fd >= 0 && srv->wake_fd >= 0 && (!signals || srv->signal_fd >= 0);
+        int *fds[] = { &srv->listen_fd, &srv->wake_fd, &srv->signal_fd };
+        for (int i = 0; ok && i < 3; i++) {
+            ev.data.ptr = fds[i];
+            if (*fds[i] >= 0 && epoll_ctl(srv->epoll_fd, EPOLL_CTL_ADD, *fds[i], &ev) != 0) ok = 0;
+        }
+        if (!ok) error = "cannot set up the event loop";
+    }
+    
+    while (error == NULL && srv->worker_count < workers) {
+        if (pthread_create(&srv->workers[srv->worker_count], NULL, server_worker, srv) != 0) {
+            error = "cannot start worker threads";
+        } else {
+            srv->worker_count++;
+        }
+    }
+    if (error != NULL) server_close(srv);
+    return error;
+}
+
+#endif /* __linux__ */
+
+// serve <socket> [workers] : answer requests until SIGINT/SIGTERM, then
+// print requests connections p50-us p99-us
+static int batch_serve(int argc, char **argv) {
+#ifdef __linux__
+    if (argc != 2 && argc != 3) return batch_error(argv[0], "usage: serve <socket> [workers]");
+    int workers = SERVER_WORKERS;
+    if (argc == 3 && (!parse_int(argv[2], &workers) || workers < 1 || workers > ELEC_MAX_THREADS)) {
+        return batch_error(argv[0], "worker count must be between 1 and 64");
+    }
+    
+    Server *srv = calloc(1, sizeof(Server));
+    if (srv == NULL) return batch_error(argv[0], "out of memory");
+    const char *error = server_open(srv, argv[1], workers, 1);
+    if (error != NULL) {
+        free(srv);
+        return batch_error(argv[0], error);
+    }
+    flush_results();
+    server_run(srv);
+    
+    double p50, p99;
+    server_percentiles(srv, &p50, &p99);
+    printf("%lld %lld %.1f %.1f\n", srv->requests, srv->connections, p50 * 1e6, p99 * 1e6);
+    server_close(srv);
+    free(srv);
+    return 0;
+#else
+    return batch_error(argv[0], "server mode needs Linux (epoll)");
+#endif
+}
+
+// cache : counters of the result cache so far (in a job file, over the
+// jobs before it)
+static int batch_cache(int argc, char **argv) {
+    if (argc != 1) return batch_error(argv[0], "usage: cache");
+    printf("%lld %lld %lld %lld %lld %zu\n", result_cache.hits, result_cache.disk_hits, result_cache.misses,
+           result_cache.evictions, result_cache.entries, result_cache.used);
+    return 0;
+}
+
+static int batch_run(int argc, char **argv);
+
+// Run a single job given as an argument vector
+static int batch_job(int argc, char **argv) {
+    if (argc == 0) return 0;
+    
+    for (int i = 0; i < UNIT_CONVERSIONS; i++) {
+        if (strcmp(argv[0], unit_conversions[i].name) == 0) return batch_convert(i, argc, argv);
+    }
+    if (strcmp(argv[0], "filter") == 0)   return batch_filter(argc, argv);
+    if (strcmp(argv[0], "eseries") == 0)  return batch_eseries(argc, argv);
+    if (strcmp(argv[0], "bode") == 0)     return batch_bode(argc, argv);
+    if (strcmp(argv[0], "rcfilter") == 0) return batch_rcfilter(argc, argv);
+    if (strcmp(argv[0], "spectrum") == 0) return batch_spectrum(argc, argv);
+    if (strcmp(argv[0], "stats") == 0)    return batch_stats(argc, argv);
+    if (strcmp(argv[0], "analyze") == 0)  return batch_analyze(argc, argv);
+    if (strcmp(argv[0], "monitor") == 0)  return batch_monitor(argc, argv);
+    if (strcmp(argv[0], "plot") == 0)     return batch_plot(argc, argv);
+    if (strcmp(argv[0], "capture") == 0)  return batch_capture(argc, argv);
+    if (strcmp(argv[0], "channels") == 0) return batch_channels(argc, argv);
+    if (strcmp(argv[0], "generate") == 0) return batch_generate(argc, argv);
+    if (strcmp(argv[0], "export") == 0)   return batch_export(argc, argv);
+    if (strcmp(argv[0], "pipeline") == 0) return batch_pipeline(argc, argv);
+    if (strcmp(argv[0], "serve") == 0)    return batch_serve(argc, argv);
+    if (strcmp(argv[0], "cache") == 0)    return batch_cache(argc, argv);
+    if (strcmp(argv[0], "run") == 0 && batch_line == 0) return batch_run(argc, argv);
+    
+    return batch_error(argv[0], "unknown command");
+}
+
+// run <job file|-> : one job per line, '#' starts a comment
+static int batch_run(int argc, char **argv) {
+    if (argc != 2) return batch_error(argv[0], "usage: run <job file|->");
+    
+    FILE *in = stdin;
+    if (strcmp(argv[1], "-") != 0) {
+        in = fopen(argv[1], "r");
+        if (in == NULL) return batch_error(argv[0], "cannot open job file");
+    }
+    
+    char line[BATCH_LINE_SIZE];
+    char *args[BATCH_MAX_ARGS + 1];
+    int failed = 0;
+    
+    batch_line = 0;
+    while (fgets(line, sizeof(line), in)) {
+        batch_line++;
+        
+        // A line that fills the buffer is skipped whole, not run in pieces
+        size_t len = strlen(line);
+        if (len == sizeof(line) - 1 && line[len - 1] != '\n') {
+            int ch = fgetc(in);
+            if (ch != EOF && ch != '\n') {
+                while ((ch = fgetc(in)) != EOF && ch != '\n') {
+                }
+                failed |= batch_error(argv[0], "line too long");
+                continue;
+            }
+        }
+        line[strcspn(line, "#\r\n")] = '\0';
+        
+        int count = 0;
+        for (char *tok = strtok(line, " \t"); tok != NULL; tok = strtok(NULL, " \t")) {
+            if (count == BATCH_MAX_ARGS + 1) break;
+            args[count++] = tok;
+        }
+        if (count > BATCH_MAX_ARGS) {
+            failed |= batch_error(args[0], "too many arguments");
+            continue;
+        }
+        failed |= batch_job(count, args);
+        
+        // The next job may wait on input (monitor, pipeline, serve) for
+        // any length of time, so nothing is left in the buffer
+        flush_results();
+    }
+    batch_line = 0;
+    
+    if (in != stdin) fclose(in);
+    return failed;
+}
+
+/* Batch mode entry point: argv holds one job (e.g. "dbm2mw 10") */
+int batch_main(int argc, char **argv) {
+    const char *results_path = "results.txt";
+    ResultFormat format = RESULT_FORMAT_TEXT;
+    
+    // Leading options
+    while (argc >= 2 && strncmp(argv[0], "--", 2) == 0) {
+        if (strcmp(argv[0], "--results") == 0) {
+            results_path = argv[1];
+        } else if (strcmp(argv[0], "--format") == 0) {
+            if (strcmp(argv[1], "text") == 0) {
+                format = RESULT_FORMAT_TEXT;
+            } else if (strcmp(argv[1], "csv") == 0) {
+                format = RESULT_FORMAT_CSV;
+            } else if (strcmp(argv[1], "bin") == 0) {
+                format = RESULT_FORMAT_BINARY;
+            } else {
+                return batch_error(argv[0], "format must be text, csv or bin");
+            }
+        } else if (strcmp(argv[0], "--threads") == 0) {
+            int threads;
+            if (!parse_int(argv[1], &threads) || threads < 1 || threads > ELEC_MAX_THREADS) {
+                return batch_error(argv[0], "thread count must be between 1 and 64");
+            }
+            elec_set_worker_threads(threads);
+        } else if (strcmp(argv[0], "--plot") == 0) {
+            int width, height, used = 0;
+            if (sscanf(argv[1], "%dx%d%n", &width, &height, &used) != 2 || argv[1][used] != '\0' ||
+                width < 2 || width > MAX_PLOT_WIDTH || height < 3 || height > MAX_PLOT_HEIGHT) {
+                return batch_error(argv[0], "plot size must be WxH, 2x3 to 1000x200");
+            }
+            set_plot_size(width, height);
+        } else if (strcmp(argv[0], "--memory") == 0) {
+            int megabytes;
+            if (!parse_int(argv[1], &megabytes) || megabytes < 0) {
+                return batch_error(argv[0], "memory limit must be a number of MB (0 for none)");
+            }
+            session_arena.limit = (size_t)megabytes << 20;
+        } else if (strcmp(argv[0], "--cache") == 0) {
+            int megabytes;
+            if (!parse_int(argv[1], &megabytes) || megabytes < 0) {
+                return batch_error(argv[0], "cache size must be a number of MB (0 for none)");
+            }
+            result_cache.budget = (size_t)megabytes << 20;
+        } else if (strcmp(argv[0], "--cache-dir") == 0) {
+            struct stat st;
+            if (stat(argv[1], &st) != 0 || !S_ISDIR(st.st_mode)) {
+                return batch_error(argv[0], "cache directory does not exist");
+            }
+            result_cache.dir = argv[1];
+        } else {
+            return batch_error(argv[0], "unknown option");
+        }
+        argc -= 2;
+        argv += 2;
+    }
+    configure_results(results_path, format, RESULT_FLUSH_INTERVAL);
+    
+    if (argc == 0 || strcmp(argv[0], "help") == 0) {
+        fprintf(stderr,
+            "usage: main.out [--results FILE] [--format text|csv|bin] [--threads N] [--plot WxH] [--memory MB]\n"
+            "                [--cache MB] [--cache-dir DIR] <command> [args]\n"
+            "  dbm2mw|mw2dbm|hz2rad|rad2hz|c2f|f2c <value>... | @<file|-> [column/columns]\n"
+            "  filter lp|hp <cutoff Hz|@file> r|c <value>   @file: one design per listed cutoff\n"
+            "  eseries E12|E24|E96 <cutoff|@file>...          nearest standard R/C pairs\n"
+            "  bode lp|hp <cutoff> r|c <value> <start> <stop> <points> [csv|bin|plot] [file|-]\n"
+            "  rcfilter lp|hp <cutoff> r|c <value> <rate> <file|-> [text|f32|i16|i32] [channels] [out.f32]\n"
+            "  spectrum <file|-> <rate> [size] [rect|hann|blackman] [text|f32|i16|i32] [bins.csv]\n"
+            "  stats <v1> <v2> ...\n"
+            "  analyze <file|->\n"
+            "  monitor <window> <decimation> [file|-]     sliding-window stats as samples arrive\n"
+            "  plot <file|-> [text|f32|i16|i32]                ASCII plot (min/max per column)\n"
+            "  capture <file> [f32|i16|i32] [scale] [offset]   binary capture, header overrides\n"
+            "  channels <file|-> <channels> [text|f32|i16|i32] [scale] [offset]  per-channel stats of interleaved frames\n"
+            "  generate sine|square|triangle|noise|gaussian <amplitude> <freq> <rate> <count> [seed]\n"
+            "  export <type> <amplitude> <freq> <rate> <count> <file> [pcm16|pcm24|pcm32|float|raw] [full-scale] [seed]\n"
+            "  pipeline <type> <amplitude> <freq> <rate> <count> lp|hp <cutoff> r|c <value> [out.f32|-] [seed]\n"
+            "  cache                   result cache counters: hits disk-hits misses evictions entries bytes\n"
+            "  serve <socket> [workers]  answer request lines from local clients until SIGINT/SIGTERM\n"
+            "  run <job file|->        one of the above per line\n");
+        return argc == 0;
+    }
+    return batch_job(argc, argv) ? 1 : 0;
+}
@@ -7,4 +7,7 @@ void menu_item_2(void);  /* RC Filter Designer */
 void menu_item_3(void);  /* Signal Analysis */
 void menu_item_4(void);  /* Waveform Generator */
 
+/* Batch (non-interactive) mode: runs one job, returns the exit status */
+int batch_main(int argc, char **argv);
+
 #endif /* FUNCS_H */
\ No newline at end of file
@@ -16,8 +16,13 @@ static void select_menu_item(int input);/* run code based on user's choice */
 static void go_back_to_main(void);      /* wait for 'b'/'B' to continue */
 static int  is_integer(const char *s);  /* validate integer string */
 
-int main(void)
+int main(int argc, char **argv)
 {
+    /* any arguments select batch mode, e.g. "./main.out run jobs.txt" */
+    if (argc > 1) {
+        return batch_main(argc - 1, argv + 1);
+    }
+
     /* this will run forever until we call exit(0) in select_menu_item() */
     for(;;) {
         main_menu();